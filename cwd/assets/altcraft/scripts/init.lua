@@ -76,33 +76,7 @@ function plugin.onRequestBlockInfo(blockPos)
 end
 
 function plugin.onChatMessage(chat, pos)
-	local chatDoc = {}
-	for i,d in ipairs(rmlui.contexts["default"].documents) do
-		if d.title == "Chat" then
-			chatDoc = d
-		end
-    end
-
-	local msg = chat:ToPlainText()
-	msg = string.gsub(msg,'&','&amp;')
-	msg = string.gsub(msg,'<','&lt;')
-	msg = string.gsub(msg,'>','&gt;')
-	msg = string.gsub(msg,'""','&quot;')
-	msg = string.gsub(msg,"''",'&apos;')
-
-	local color = ""
-	if pos == 0 then
-		color = ""
-	elseif pos == 1 then
-		color = 'style="color: #BBBBBB"'
-	elseif pos == 2 then
-		color = 'style="color: maroon"'
-	else
-		color = 'style="color: navy"'
-	end
-
-	chatDoc:GetElementById('chat').inner_rml = chatDoc:GetElementById('chat').inner_rml .. string.format('<p class="chat-msg" %s>%s</p>', color, msg)
-	MoveChatToBottom = true
+	AC.AppendChat(chat, pos)
 end
 
 function plugin.onDisconnected(reason)
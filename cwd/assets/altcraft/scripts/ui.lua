@@ -11,6 +11,15 @@ local options = {
 	smoothlight = false,
 	ssaoSamples = 0,
 	ssaoScale = 0.5,
+	ssaoAdaptive = false,
+	chunkCache = false,
+	lodDistance = 8,
+	dynamicResolution = false,
+	hudRefreshRate = 10,
+	pipelinedRendering = false,
+	lateInputSampling = false,
+	gpuTimers = false,
+	uploadThread = false,
 }
 
 function OpenOptions(doc)
@@ -81,79 +90,20 @@ function OptionsDefaultHandler(event)
 	end
 end
 
-local lastFps = {}
-
-local function UpdateFps(newFps)
-	lastFps[#lastFps + 1] = newFps
-	if #lastFps >= 100 then
-		table.remove(lastFps, 1)
-	end
-	local smoothFps = 0
-	for i,v in ipairs(lastFps) do
-		smoothFps = smoothFps + v
+local function SetInnerRml(element, rml)
+	if element.inner_rml ~= rml then
+		element.inner_rml = rml
 	end
-	smoothFps = smoothFps / #lastFps
-	return smoothFps
 end
 
 function UpdateUi()
-	local doc = {}
 	local uiDoc = {}
-	local chatDoc = {}
 	for i,d in ipairs(rmlui.contexts["default"].documents) do
-		if d.title == "Playing" then
-			doc = d
-		elseif d.title == "Options" then
+		if d.title == "Options" then
 			uiDoc = d
-		elseif d.title == "Chat" then
-			chatDoc = d
 		end
     end
 
-	if MoveChatToBottom ~= nil and MoveChatToBottom == true then
-		chatDoc:GetElementById('chat').scroll_top = chatDoc:GetElementById('chat').scroll_height
-	end
-
-	if AC.GetGameState() and AC.GetGameState():GetPlayer() and AC.GetGameState():GetTimeStatus().worldAge > 0 then
-		local time = AC.GetTime()
-		local rawFps = 1.0 / time:GetRealDeltaS()
-		local smoothFps = UpdateFps(rawFps)
-		doc:GetElementById('dbg-fps').inner_rml = string.format("%.1f", smoothFps)
-
-		local playerEnt = AC.GetGameState():GetPlayer()				
-		doc:GetElementById('dbg-pos').inner_rml = string.format("%.1f %.1f %.1f", playerEnt.pos.x, playerEnt.pos.y, playerEnt.pos.z)
-
-		local wrld = AC.GetGameState():GetWorld()
-		local selection = AC.GetGameState():GetSelectionStatus()
-		if selection.isBlockSelected then
-			bid = wrld:GetBlockId(selection.selectedBlock)
-			binfo = AC.GetBlockInfo(bid)
-			light = wrld:GetBlockLight(selection.selectedBlock)
-			skyLight = wrld:GetBlockSkyLight(selection.selectedBlock)
-			doc:GetElementById('dbg-select-pos').inner_rml = tostring(selection.selectedBlock)
-			doc:GetElementById('dbg-select-bid').inner_rml = string.format("%d:%d", bid.id, bid.state)
-			doc:GetElementById('dbg-select-name').inner_rml = string.format("%s:%s", binfo.blockstate, binfo.variant)
-			doc:GetElementById('dbg-select-light').inner_rml = string.format("%d:%d", light, skyLight)
-		else
-			doc:GetElementById('dbg-select-pos').inner_rml = ""
-			doc:GetElementById('dbg-select-bid').inner_rml = ""
-			doc:GetElementById('dbg-select-name').inner_rml = ""
-			doc:GetElementById('dbg-select-light').inner_rml = ""
-		end
-
-		doc:GetElementById('dbg-sections-loaded').inner_rml = AC.GetDebugValue(0)
-		doc:GetElementById('dbg-sections-renderer').inner_rml = AC.GetDebugValue(1)
-		doc:GetElementById('dbg-sections-ready').inner_rml = AC.GetDebugValue(2)
-		doc:GetElementById('dbg-sections-culled').inner_rml = AC.GetDebugValue(0) - AC.GetDebugValue(5)
-		doc:GetElementById('dbg-rendered-faces').inner_rml = AC.GetDebugValue(4)
-
-		local player = AC.GetGameState():GetPlayerStatus()
-		local playerHp = string.format("%.0f", player.health)
-		doc:GetElementById('status-hp').inner_rml = playerHp
-		doc:GetElementById('status-hp-bar'):SetAttribute("value", playerHp)
-	end
-
-
 	local uiInit = optionsListenersAdded == nil
 	if uiInit then
 	AC.Settings.Load()
@@ -182,18 +132,19 @@ function UpdateUi()
 		if type(v) == "number" then
 			local val = input:GetAttribute("value")
 			if v == math.floor(v) and i ~= "resolutionScale" then
-				span.inner_rml = string.format("%d (%d)", math.floor(val), v)
 				if i == "targetFps" and val == 301 then
-					span.inner_rml = string.format("∞ (%d)",  v)
+					SetInnerRml(span, string.format("∞ (%d)",  v))
+				else
+					SetInnerRml(span, string.format("%d (%d)", math.floor(val), v))
 				end
 			else
-				span.inner_rml = string.format("%.2f (%.2f)", val, v)
+				SetInnerRml(span, string.format("%.2f (%.2f)", val, v))
 			end
 		elseif type(v) == "boolean" then
 			if v then
-				span.inner_rml = "(on)"
+				SetInnerRml(span, "(on)")
 			else
-				span.inner_rml = "(off)"
+				SetInnerRml(span, "(off)")
 			end
 		end
 	end
@@ -7,15 +7,29 @@ in vec2 uv;
 uniform sampler2D blurInput;
 uniform int blurScale;
 
+layout (std140) uniform Globals {
+    mat4 projView;
+    mat4 proj;
+    mat4 invProj;
+    mat4 view;
+    uvec2 viewportSize;
+    float globalTime;
+    float dayTime;
+    float gamma;
+    vec2 renderScale;
+};
+
 void main() {
     vec2 texelSize = 1.0f / vec2(textureSize(blurInput, 0));
+    vec2 texUv = uv * renderScale;
+    vec2 maxUv = renderScale - texelSize * 0.5f;
     vec4 result = vec4(0.0f);
     for (int x = -blurScale; x < blurScale; x++) 
     {
         for (int y = -blurScale; y < blurScale; y++) 
         {
             vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(blurInput, uv + offset);
+            result += texture(blurInput, min(texUv + offset, maxUv));
         }
     }
     fragColor = result / pow(blurScale * 2.0f, 2);
@@ -0,0 +1,24 @@
+#version 330 core
+
+in vec2 uv;
+
+out vec4 fragColor;
+
+uniform sampler2D inputTexture;
+
+layout (std140) uniform Globals {
+    mat4 projView;
+    mat4 proj;
+    mat4 invProj;
+    mat4 view;
+    uvec2 viewportSize;
+    float globalTime;
+    float dayTime;
+    float gamma;
+    vec2 renderScale;
+};
+
+//Copies active part of the dynamically scaled input texture to the whole output
+void main() {
+    fragColor = texture(inputTexture, uv * renderScale);
+}
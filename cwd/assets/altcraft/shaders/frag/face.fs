@@ -5,6 +5,7 @@ in vec3 faceAddColor;
 in vec3 faceNormal;
 in vec2 faceLight;
 in float faceAmbientOcclusion;
+in float faceCornerAo;
 
 layout (location = 0) out vec4 color;
 layout (location = 1) out vec4 normal;
@@ -12,12 +13,21 @@ layout (location = 2) out vec4 light;
 
 uniform sampler2DArray textureAtlas;
 
+//Octahedral encoding of a unit normal into [0, 1]^2, stored in a RG8 target
+vec2 EncodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    vec2 e = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signs;
+    return e * 0.5f + 0.5f;
+}
+
 void main() {
     vec4 col = texture(textureAtlas, faceTextureUv);
     if (col.a < 0.3)
         discard;
 
-    color = vec4(col.rgb * faceAddColor.rgb, 1.0f);
-    normal = vec4(faceNormal, 1.0f);
-    light = vec4(faceLight / 15.0f, faceAmbientOcclusion, 1.0f);
+    //Baked occlusion darkens albedo, so it needs no G-buffer channel
+    color = vec4(col.rgb * faceAddColor.rgb * faceCornerAo, faceAmbientOcclusion);
+    normal = vec4(EncodeNormal(normalize(faceNormal)), 0.0f, 1.0f);
+    light = vec4(faceLight / 15.0f, 0.0f, 1.0f);
 }
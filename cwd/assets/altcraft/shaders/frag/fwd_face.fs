@@ -5,6 +5,7 @@ in vec3 faceTextureUv;
 in vec3 faceAddColor;
 in vec3 faceNormal;
 in vec2 faceLight;
+in float faceCornerAo;
 
 out vec4 fragColor;
 
@@ -16,10 +17,10 @@ layout (std140) uniform Globals {
     mat4 invProj;
     mat4 view;
     uvec2 viewportSize;
-    vec4 ssaoKernels[64];
     float globalTime;
     float dayTime;
     float gamma;
+    vec2 renderScale;
 };
 
 void main() {
@@ -31,7 +32,7 @@ void main() {
     float skyLight = faceLight.g / 15.0f;
     float lightLevel = clamp(localLight + skyLight * dayTime, 0.01f, 1.0f);
     lightLevel = pow(lightLevel, 3);
-    lightLevel = clamp(lightLevel, 0.005f, 1.0f);
+    lightLevel = clamp(lightLevel * faceCornerAo, 0.005f, 1.0f);
 
     fragColor = vec4(col.rgb * faceAddColor.rgb * lightLevel, 1.0f);
 
@@ -16,10 +16,10 @@ layout (std140) uniform Globals {
     mat4 invProj;
     mat4 view;
     uvec2 viewportSize;
-    vec4 ssaoKernels[64];
     float globalTime;
     float dayTime;
     float gamma;
+    vec2 renderScale;
 };
 
 void main() {
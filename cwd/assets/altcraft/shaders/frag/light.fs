@@ -12,6 +12,7 @@ uniform sampler2D ssao;
 
 uniform int renderBuff;
 uniform bool applySsao;
+uniform bool ssaoUpsample;
 
 layout (std140) uniform Globals {
     mat4 projView;
@@ -19,27 +20,63 @@ layout (std140) uniform Globals {
     mat4 invProj;
     mat4 view;
     uvec2 viewportSize;
-    vec4 ssaoKernels[64];
     float globalTime;
     float dayTime;
     float gamma;
+    vec2 renderScale;
 };
 
+//Inverse of octahedral encoding in face.fs
+vec3 DecodeNormal(vec2 e) {
+    e = e * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+
 vec3 RecoverViewWorldPos(vec2 screenPos, float depth) {
     vec4 viewPos = invProj * vec4(screenPos * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
     return viewPos.xyz / viewPos.w;
 }
 
+//Joins 4 nearest low resolution ssao texels, texels lying on other surfaces are rejected by depth
+float UpsampleSsao(vec2 texUv, float viewZ) {
+    vec2 ssaoSize = vec2(textureSize(ssao, 0));
+    ivec2 maxTexel = ivec2(ssaoSize * renderScale) - 1;
+    vec2 ssaoPos = texUv * ssaoSize - 0.5f;
+    vec2 base = floor(ssaoPos);
+    vec2 f = ssaoPos - base;
+
+    float result = 0.0f;
+    float weightSum = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        vec2 offset = vec2(i & 1, i >> 1);
+        ivec2 texel = clamp(ivec2(base + offset), ivec2(0), maxTexel);
+        vec2 sampleUv = (vec2(texel) + 0.5f) / ssaoSize;
+        float sampleZ = RecoverViewWorldPos(sampleUv / renderScale, texture(depthStencil, sampleUv).r).z;
+        vec2 bilinear = mix(1.0f - f, f, offset);
+        float weight = bilinear.x * bilinear.y / (0.01f + abs(viewZ - sampleZ));
+        result += texelFetch(ssao, texel, 0).r * weight;
+        weightSum += weight;
+    }
+    return weightSum > 0.0f ? result / weightSum : texture(ssao, texUv).r;
+}
+
 void main() {
-    vec4 c = texture(color, uv);
-    vec4 n = texture(normal, uv);
-    n += 1.0f;
-    n /= 2.0f;
+    vec2 texUv = uv * renderScale;
+    vec4 c = texture(color, texUv);
+    vec4 n = vec4(DecodeNormal(texture(normal, texUv).rg), 1.0f);
+    n.rgb += 1.0f;
+    n.rgb /= 2.0f;
 
-    vec4 l = texture(light, uv);
-    float depth = texture(depthStencil, uv).r;
+    vec4 l = texture(light, texUv);
+    float depth = texture(depthStencil, texUv).r;
     float d = (1.0f - depth) * 16.0f;
-    vec4 s = texture(ssao, uv);
+    vec4 s = vec4(1.0f);
+    if (applySsao) {
+        s = ssaoUpsample ? vec4(UpsampleSsao(texUv, RecoverViewWorldPos(uv, depth).z)) : texture(ssao, texUv);
+    }
 
     float faceLight = l.r;
     float skyLight = l.g;
@@ -59,7 +96,7 @@ void main() {
             fragColor = finalColor;
             break;
         case 1:
-            fragColor = c;
+            fragColor = vec4(c.rgb, 1.0f);
             break;
         case 2:
             fragColor = n;
@@ -71,7 +108,7 @@ void main() {
             fragColor = vec4(0.5f);
             break;
         case 5:
-            fragColor = vec4(l.r, l.g, 1.0f - l.b, 1.0f);
+            fragColor = vec4(l.r, l.g, 1.0f - c.a, 1.0f);
             break;
         case 6:
             fragColor = vec4(vec3(d), 1.0f);
@@ -12,11 +12,19 @@ layout (location = 2) out vec4 light;
 
 uniform sampler2DArray textureAtlas;
 
+//Octahedral encoding of a unit normal into [0, 1]^2, stored in a RG8 target
+vec2 EncodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    vec2 e = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signs;
+    return e * 0.5f + 0.5f;
+}
+
 void main() {
     vec4 col = texture(textureAtlas, faceTextureUv);
 
-    color = vec4(col.rgb * faceAddColor.rgb, 1.0f);
-    normal = vec4(faceNormal, 1.0f);
-    light = vec4(faceLight / 15.0f, faceAmbientOcclusion, 1.0f);
-    color.a = col.a;
+    //Alpha is only the blending factor here, blending keeps ssao mask of the target
+    color = vec4(col.rgb * faceAddColor.rgb, col.a);
+    normal = vec4(EncodeNormal(normalize(faceNormal)), 0.0f, 1.0f);
+    light = vec4(faceLight / 15.0f, 0.0f, 1.0f);
 }
@@ -12,10 +12,10 @@ layout (std140) uniform Globals {
     mat4 invProj;
     mat4 view;
     uvec2 viewportSize;
-    vec4 ssaoKernels[64];
     float globalTime;
     float dayTime;
     float gamma;
+    vec2 renderScale;
 };
 
 uniform sampler2DArray textureAtlas;
@@ -63,7 +63,8 @@ void main() {
     color = vec4(mix(NightSkyColor, DaySkyColor, dayTime).rgb, 1.0f);
     color += vec4(Sun().rgb, 1.0f);
     color += vec4(Moon().rgb, 1.0f);
-    normal = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    color.a = 0.0f;
+    normal = vec4(0.5f, 0.5f, 0.0f, 1.0f);
     light = vec4(1.0f, 1.0f, 0.0f, 1.0f);
     gl_FragDepth = 1.0f;
 }
@@ -5,7 +5,7 @@ out vec4 fragColor;
 in vec2 uv;
 
 uniform sampler2D normal;
-uniform sampler2D light;
+uniform sampler2D color;
 uniform sampler2D depthStencil;
 uniform sampler2D ssaoNoise;
 
@@ -17,10 +17,14 @@ layout (std140) uniform Globals {
     mat4 invProj;
     mat4 view;
     uvec2 viewportSize;
-    vec4 ssaoKernels[64];
     float globalTime;
     float dayTime;
     float gamma;
+    vec2 renderScale;
+};
+
+layout (std140) uniform SsaoKernels {
+    vec4 ssaoKernels[64];
 };
 
 const vec2 noiseScale = vec2(4.0f, 4.0f);
@@ -28,14 +32,24 @@ const int kernelSize = 64;
 const float radius = 0.5f;
 const float bias = 0.025f;
 
+//Inverse of octahedral encoding in face.fs
+vec3 DecodeNormal(vec2 e) {
+    e = e * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+
 vec3 RecoverViewWorldPos(vec2 screenPos, float depth) {
     vec4 viewPos = invProj * vec4(screenPos * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
     return viewPos.xyz / viewPos.w;
 }
 
 void main() {
-    vec3 normal = texture(normal, uv).xyz;
-    vec3 fragPos = RecoverViewWorldPos(uv, texture(depthStencil, uv).r);
+    vec2 texUv = uv * renderScale;
+    vec3 normal = DecodeNormal(texture(normal, texUv).rg);
+    vec3 fragPos = RecoverViewWorldPos(uv, texture(depthStencil, texUv).r);
     vec2 noiseUv = uv * viewportSize / noiseScale;
 
     vec3 randomVec = texture(ssaoNoise, noiseUv).xyz;
@@ -56,9 +70,9 @@ void main() {
         offset.xyz /= offset.w;
         offset.xyz  = offset.xyz * 0.5 + 0.5;
 
-        float sampleDepth = RecoverViewWorldPos(offset.xy, texture(depthStencil, offset.xy).r).z;
+        float sampleDepth = RecoverViewWorldPos(offset.xy, texture(depthStencil, offset.xy * renderScale).r).z;
         float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
-        float aoMask = texture(light, offset.xy).b;
+        float aoMask = texture(color, offset.xy * renderScale).a;
         occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck * aoMask;
     }
 
@@ -6,12 +6,14 @@ in vec2 light[4];
 in vec3 normal;
 in vec3 color;
 in vec3 layerAnimationAo;
+in vec4 cornerAo;
 
 out vec3 faceTextureUv;
 out vec3 faceNormal;
 out vec3 faceAddColor;
 out vec2 faceLight;
 out float faceAmbientOcclusion;
+out float faceCornerAo;
 
 layout (std140) uniform Globals {
     mat4 projView;
@@ -19,10 +21,10 @@ layout (std140) uniform Globals {
     mat4 invProj;
     mat4 view;
     uvec2 viewportSize;
-    vec4 ssaoKernels[64];
     float globalTime;
     float dayTime;
     float gamma;
+    vec2 renderScale;
 };
 
 void main() {
@@ -35,4 +37,5 @@ void main() {
     faceAddColor = color;
     faceLight = light[gl_VertexID];
     faceAmbientOcclusion = layerAnimationAo.b;
+    faceCornerAo = cornerAo[gl_VertexID];
 }
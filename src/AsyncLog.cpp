@@ -0,0 +1,301 @@
+#include "AsyncLog.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <easylogging++.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t bufferCapacity = 1024;
+    constexpr size_t siteBurst = 20;
+    constexpr std::chrono::seconds siteWindow(1);
+    constexpr std::chrono::milliseconds writerInterval(10);
+    constexpr std::chrono::seconds repeatsFlushInterval(1);
+
+    struct Entry {
+        el::Level level = el::Level::Info;
+        std::string line;
+        bool repeat = false; //previous message of the thread logged again, line is empty
+    };
+
+    /*
+     * Ring of formatted lines. Pushed only by the owning thread and
+     * popped only by the writer thread, so it needs no locks.
+     */
+    struct ThreadBuffer {
+        Entry entries[bufferCapacity];
+        std::atomic<size_t> head{ 0 };
+        std::atomic<size_t> tail{ 0 };
+        std::atomic<size_t> dropped{ 0 };
+        std::atomic<bool> closed{ false };
+
+        //Collapsed repeats, used only by the writer thread
+        el::Level repeatsLevel = el::Level::Info;
+        size_t repeats = 0;
+        Clock::time_point lastRepeat;
+
+        bool Push(el::Level level, std::string &&line, bool repeat = false) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) >= bufferCapacity) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            entries[t % bufferCapacity].level = level;
+            entries[t % bufferCapacity].line = std::move(line);
+            entries[t % bufferCapacity].repeat = repeat;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(Entry &entry) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+                return false;
+            entry = std::move(entries[h % bufferCapacity]);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+    };
+
+    //Producer side state, used only by the owning thread
+    struct ThreadState {
+        struct Site {
+            Clock::time_point windowStart;
+            size_t count = 0;
+            size_t suppressed = 0;
+        };
+
+        std::shared_ptr<ThreadBuffer> buffer;
+        std::map<std::pair<std::string, unsigned long>, Site> sites;
+        std::string lastMessage;
+        el::Level lastLevel = el::Level::Info;
+
+        ~ThreadState() {
+            if (buffer)
+                buffer->closed = true;
+        }
+    };
+
+    struct Writer {
+        std::mutex buffersMutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+        std::mutex outputMutex;
+        std::ofstream file;
+        bool colored = false;
+
+        std::mutex wakeMutex;
+        std::condition_variable wakeCv;
+        std::atomic<bool> running{ false };
+        std::atomic<size_t> pushing{ 0 }; //producers that passed the running check and not yet pushed
+        std::thread thread;
+    } writer;
+
+    thread_local ThreadState threadState;
+
+    void WriteLine(el::Level level, const std::string &line) {
+        if (writer.colored) {
+            const char *color = nullptr;
+            switch (level) {
+            case el::Level::Error:
+            case el::Level::Fatal:
+                color = "\x1b[31m";
+                break;
+            case el::Level::Warning:
+                color = "\x1b[33m";
+                break;
+            case el::Level::Debug:
+                color = "\x1b[32m";
+                break;
+            case el::Level::Info:
+                color = "\x1b[36m";
+                break;
+            default:
+                break;
+            }
+            if (color)
+                std::cout << color << line << "\x1b[0m";
+            else
+                std::cout << line;
+        } else {
+            std::cout << line;
+        }
+
+        if (writer.file.is_open())
+            writer.file << line;
+    }
+
+    void FlushRepeats(ThreadBuffer &buffer) {
+        if (!buffer.repeats)
+            return;
+        WriteLine(buffer.repeatsLevel, "Last message repeated " + std::to_string(buffer.repeats) + " times\n");
+        buffer.repeats = 0;
+    }
+
+    //Returns true if anything was written. Repeats are written when another message arrives,
+    //when no repeat came for repeatsFlushInterval or when flushAll is set
+    bool DrainBuffers(bool flushAll = false) {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(writer.buffersMutex);
+            buffers = writer.buffers;
+        }
+
+        bool written = false;
+        std::lock_guard<std::mutex> lock(writer.outputMutex);
+        Entry entry;
+        auto now = Clock::now();
+        for (auto &buffer : buffers) {
+            while (buffer->Pop(entry)) {
+                if (entry.repeat) {
+                    buffer->repeats++;
+                    buffer->repeatsLevel = entry.level;
+                    buffer->lastRepeat = now;
+                    continue;
+                }
+                FlushRepeats(*buffer);
+                WriteLine(entry.level, entry.line);
+                written = true;
+            }
+            if (buffer->repeats && (flushAll || buffer->closed || now - buffer->lastRepeat >= repeatsFlushInterval)) {
+                FlushRepeats(*buffer);
+                written = true;
+            }
+            size_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped) {
+                WriteLine(el::Level::Warning, std::to_string(dropped) + " log messages dropped, log buffer is full\n");
+                written = true;
+            }
+        }
+
+        if (written) {
+            std::cout.flush();
+            if (writer.file.is_open())
+                writer.file.flush();
+        }
+
+        std::lock_guard<std::mutex> buffersLock(writer.buffersMutex);
+        for (auto it = writer.buffers.begin(); it != writer.buffers.end();) {
+            if ((*it)->closed && (*it)->head == (*it)->tail && !(*it)->repeats)
+                it = writer.buffers.erase(it);
+            else
+                ++it;
+        }
+
+        return written;
+    }
+
+    void WriterFunction() {
+        el::Helpers::setThreadName("Log");
+        while (writer.running) {
+            DrainBuffers();
+            std::unique_lock<std::mutex> lock(writer.wakeMutex);
+            writer.wakeCv.wait_for(lock, writerInterval, [] { return !writer.running; });
+        }
+    }
+
+    void WriteSynchronously(el::Level level, const std::string &line) {
+        DrainBuffers(true);
+        std::lock_guard<std::mutex> lock(writer.outputMutex);
+        WriteLine(level, line);
+        std::cout.flush();
+        if (writer.file.is_open())
+            writer.file.flush();
+    }
+
+    class AsyncLogSink : public el::LogDispatchCallback {
+    protected:
+        void handle(const el::LogDispatchData *data) override {
+            if (data->dispatchAction() != el::base::DispatchAction::NormalLog)
+                return;
+
+            const el::LogMessage *message = data->logMessage();
+            el::Level level = message->level();
+
+            writer.pushing.fetch_add(1);
+            if (level == el::Level::Fatal || !writer.running) {
+                writer.pushing.fetch_sub(1);
+                WriteSynchronously(level, message->logger()->logBuilder()->build(message, true));
+                return;
+            }
+            Push(message, level);
+            writer.pushing.fetch_sub(1);
+        }
+
+        void Push(const el::LogMessage *message, el::Level level) {
+            ThreadState &state = threadState;
+            if (!state.buffer) {
+                state.buffer = std::make_shared<ThreadBuffer>();
+                std::lock_guard<std::mutex> lock(writer.buffersMutex);
+                writer.buffers.push_back(state.buffer);
+            }
+
+            if (message->message() == state.lastMessage && level == state.lastLevel) {
+                state.buffer->Push(level, std::string(), true);
+                return;
+            }
+            state.lastMessage = message->message();
+            state.lastLevel = level;
+
+            auto now = Clock::now();
+            ThreadState::Site &site = state.sites[{ message->file(), static_cast<unsigned long>(message->line()) }];
+            if (now - site.windowStart >= siteWindow) {
+                if (site.suppressed) {
+                    state.buffer->Push(el::Level::Warning, std::to_string(site.suppressed) + " messages from " +
+                        message->file() + ":" + std::to_string(message->line()) + " suppressed\n");
+                }
+                site.windowStart = now;
+                site.count = 0;
+                site.suppressed = 0;
+            }
+            if (site.count >= siteBurst) {
+                site.suppressed++;
+                return;
+            }
+            site.count++;
+
+            state.buffer->Push(level, message->logger()->logBuilder()->build(message, true));
+        }
+    };
+}
+
+void AsyncLog::Init(const std::string &filePath) {
+    if (!filePath.empty()) {
+        std::error_code ec;
+        std::filesystem::path path(filePath);
+        if (path.has_parent_path())
+            std::filesystem::create_directories(path.parent_path(), ec);
+        writer.file.open(filePath, std::ios::app);
+    }
+    writer.colored = el::Loggers::hasFlag(el::LoggingFlag::ColoredTerminalOutput);
+
+    el::Helpers::installLogDispatchCallback<AsyncLogSink>("AsyncLogSink");
+    el::Helpers::uninstallLogDispatchCallback<el::base::DefaultLogDispatchCallback>("DefaultLogDispatchCallback");
+
+    writer.running = true;
+    writer.thread = std::thread(WriterFunction);
+}
+
+void AsyncLog::Shutdown() {
+    if (!writer.running)
+        return;
+    writer.running = false;
+    writer.wakeCv.notify_all();
+    writer.thread.join();
+
+    //Messages of producers that passed the running check before it was cleared
+    while (writer.pushing)
+        std::this_thread::yield();
+    DrainBuffers(true);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+/*
+ * Asynchronous easylogging++ sink.
+ * Replaces the default dispatch callback: formatted lines are pushed into a
+ * per-thread lock-free ring and written to terminal and file by a background thread,
+ * so logging never waits for terminal output. Messages repeated by a thread are
+ * collapsed by the writer and reported after a second without repeats at the latest,
+ * every call site is limited to a burst of messages per second,
+ * suppressed messages are reported by count. Fatal messages are written synchronously.
+ */
+namespace AsyncLog {
+    void Init(const std::string &filePath);
+
+    //Writes all pending messages and stops the writer thread
+    void Shutdown();
+}
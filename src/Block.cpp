@@ -2,6 +2,8 @@
 
 #include <map>
 
+#include "DebugInfo.hpp"
+
 static std::map<BlockId, BlockInfo> blocks;
 static std::map<BlockId, LiquidInfo> liquids;
 
@@ -19,6 +21,7 @@ void RegisterStaticLiquidInfo(BlockId blockId, const LiquidInfo& liquidInfo) {
 }
 
 BlockInfo* GetBlockInfo(BlockId blockId) {
+    HOT_COUNT(GetBlockInfo);
     auto it = blocks.find(blockId);
     return it != blocks.end() ? &it->second : &UnknownBlock;
 }
@@ -0,0 +1,176 @@
+#include "ChatLog.hpp"
+
+#include <optick.h>
+#include <RmlUi/Core.h>
+
+#include "Chat.hpp"
+#include "Utility.hpp"
+
+namespace {
+    std::string EscapeRml(const std::string &text) {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (char c : text) {
+            switch (c) {
+            case '&':
+                escaped += "&amp;";
+                break;
+            case '<':
+                escaped += "&lt;";
+                break;
+            case '>':
+                escaped += "&gt;";
+                break;
+            case '"':
+                escaped += "&quot;";
+                break;
+            case '\'':
+                escaped += "&apos;";
+                break;
+            default:
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    const char *GetPositionColor(int position) {
+        switch (position) {
+        case 0:
+            return nullptr;
+        case 1:
+            return "#BBBBBB";
+        case 2:
+            return "maroon";
+        default:
+            return "navy";
+        }
+    }
+}
+
+ChatLog::ChatLog() : lines(historySize) {
+
+}
+
+bool ChatLog::IsAtBottom() const {
+    return container->GetScrollTop() + container->GetClientHeight() >= container->GetScrollHeight() - 1.0f;
+}
+
+Rml::ObserverPtr<Rml::Element> ChatLog::Bind(Rml::Context *context) {
+    //Elements of the previous container are destroyed with it
+    for (size_t i = 0; i < count; i++)
+        GetLine(i).element = nullptr;
+    materializedCount = 0;
+
+    for (int i = 0; i < context->GetNumDocuments(); i++) {
+        Rml::ElementDocument *document = context->GetDocument(i);
+        if (document->GetTitle() != "Chat")
+            continue;
+        if (Rml::Element *element = document->GetElementById("chat"))
+            return element->GetObserverPtr();
+    }
+    return Rml::ObserverPtr<Rml::Element>();
+}
+
+void ChatLog::Materialize(Line &line, Rml::Element *before) {
+    Rml::ElementPtr element = container->GetOwnerDocument()->CreateElement("p");
+    element->SetClass("chat-msg", true);
+    if (const char *color = GetPositionColor(line.position))
+        element->SetProperty("color", color);
+    element->SetInnerRML(EscapeRml(line.text));
+
+    if (before)
+        line.element = container->InsertBefore(std::move(element), before);
+    else
+        line.element = container->AppendChild(std::move(element));
+}
+
+void ChatLog::Dematerialize(Line &line) {
+    if (line.element && container)
+        container->RemoveChild(line.element);
+    line.element = nullptr;
+}
+
+void ChatLog::MaterializeOlder() {
+    size_t first = count - materializedCount;
+    size_t toAdd = _min(pageLines, first);
+    Rml::Element *before = materializedCount ? GetLine(first).element : nullptr;
+    for (size_t i = 0; i < toAdd; i++) {
+        Line &line = GetLine(first - 1 - i);
+        Materialize(line, before);
+        before = line.element;
+    }
+    materializedCount += toAdd;
+}
+
+void ChatLog::DematerializeOldest(size_t keep) {
+    while (materializedCount > keep) {
+        Dematerialize(GetLine(count - materializedCount));
+        materializedCount--;
+    }
+}
+
+void ChatLog::Append(const Chat &chat, int position) {
+    OPTICK_EVENT();
+    bool atBottom = !container || IsAtBottom();
+
+    if (count == lines.size()) {
+        if (materializedCount == count) {
+            Dematerialize(GetLine(0));
+            materializedCount--;
+        }
+        head = (head + 1) % lines.size();
+        count--;
+    }
+
+    Line &line = GetLine(count++);
+    line.text = chat.ToPlainText();
+    line.position = position;
+    line.element = nullptr;
+
+    if (!container)
+        return;
+
+    Materialize(line, nullptr);
+    materializedCount++;
+
+    if (atBottom) {
+        DematerializeOldest(materializedLines);
+        scrollToBottom = true;
+    }
+}
+
+void ChatLog::Clear() {
+    if (container)
+        DematerializeOldest(0);
+    head = 0;
+    count = 0;
+    materializedCount = 0;
+}
+
+void ChatLog::Update(Rml::Context *context) {
+    OPTICK_EVENT();
+    if (!container) {
+        container = Bind(context);
+        if (!container)
+            return;
+        while (materializedCount < _min(count, materializedLines))
+            MaterializeOlder();
+        scrollToBottom = true;
+        return;
+    }
+
+    //Elements added here are laid out during next context update, so scrolling is deferred by a frame
+    if (scrollHeightBeforeMaterialize >= 0.0f) {
+        container->SetScrollTop(container->GetScrollTop() + container->GetScrollHeight() - scrollHeightBeforeMaterialize);
+        scrollHeightBeforeMaterialize = -1.0f;
+    } else if (scrollToBottom) {
+        container->SetScrollTop(container->GetScrollHeight());
+        scrollToBottom = false;
+    } else if (container->GetScrollTop() <= 0.0f && materializedCount < count) {
+        scrollHeightBeforeMaterialize = container->GetScrollHeight();
+        MaterializeOlder();
+    } else if (materializedCount > materializedLines && IsAtBottom()) {
+        DematerializeOldest(materializedLines);
+    }
+}
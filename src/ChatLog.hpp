@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <RmlUi/Core/ObserverPtr.h>
+
+class Chat;
+namespace Rml
+{
+    class Context;
+    class Element;
+}
+
+/*
+ * Chat history bound to the "chat" element of the Chat document.
+ * Lines are kept in a bounded ring buffer, only the newest part of it is
+ * materialized into Rml elements, older lines are materialized page by page
+ * when the log is scrolled to the top. Every message appends a single element,
+ * so the whole history is never re-parsed.
+ * The container is observed, if the Chat document is reloaded the log is bound to the new one.
+ */
+class ChatLog {
+    struct Line {
+        std::string text;
+        int position = 0;
+        Rml::Element *element = nullptr;
+    };
+
+    std::vector<Line> lines;
+    size_t head = 0; //index of the oldest line
+    size_t count = 0;
+    size_t materializedCount = 0; //newest lines having an element
+
+    Rml::ObserverPtr<Rml::Element> container;
+    bool scrollToBottom = false;
+    float scrollHeightBeforeMaterialize = -1.0f;
+
+    static constexpr size_t historySize = 500;
+    static constexpr size_t materializedLines = 100;
+    static constexpr size_t pageLines = 25;
+
+    Line &GetLine(size_t index) {
+        return lines[(head + index) % lines.size()];
+    }
+
+    bool IsAtBottom() const;
+
+    Rml::ObserverPtr<Rml::Element> Bind(Rml::Context *context);
+
+    void Materialize(Line &line, Rml::Element *before);
+
+    void Dematerialize(Line &line);
+
+    void MaterializeOlder();
+
+    void DematerializeOldest(size_t keep);
+
+public:
+    ChatLog();
+
+    ChatLog(const ChatLog &) = delete;
+
+    ChatLog &operator=(const ChatLog &) = delete;
+
+    void Append(const Chat &chat, int position);
+
+    void Clear();
+
+    //Called once per frame after Rml context update
+    void Update(Rml::Context *context);
+};
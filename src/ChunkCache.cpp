@@ -0,0 +1,402 @@
+#include "ChunkCache.hpp"
+
+#include <array>
+#include <bitset>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+
+#include <zlib.h>
+#include <easylogging++.h>
+#include <optick.h>
+
+#include "Stream.hpp"
+#include "RendererSectionData.hpp"
+
+namespace fs = std::filesystem;
+
+const fs::path pathToCache = "./cache/";
+const char CacheMagic[4] = { 'A', 'C', 'C', 'C' };
+const unsigned int CacheFormatVersion = 2;
+const size_t RecordHeaderSize = 3 * sizeof(unsigned int);
+const size_t FileHeaderSize = sizeof(CacheMagic) + sizeof(CacheFormatVersion);
+
+static std::string SanitizeName(const std::string &name) {
+    std::string result = name;
+    for (char &c : result) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-')
+            c = '_';
+    }
+    return result;
+}
+
+static bool Compress(const std::vector<unsigned char> &data, std::vector<unsigned char> &compressed) {
+    uLongf compressedSize = compressBound(data.size());
+    compressed.resize(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, data.data(), data.size(), Z_BEST_SPEED) != Z_OK)
+        return false;
+    compressed.resize(compressedSize);
+    return true;
+}
+
+ChunkCache::ChunkCache(const std::string &serverName, int dimension) {
+    fs::path path = pathToCache / SanitizeName(serverName) / std::to_string(dimension);
+    std::error_code ec;
+    fs::create_directories(path, ec);
+    if (ec)
+        LOG(ERROR) << "Chunk cache directory not created " << path.string() << ": " << ec.message();
+    directory = path.string();
+
+    writer = std::thread(&ChunkCache::WriterFunction, this);
+    LOG(INFO) << "Chunk cache opened at " << directory;
+}
+
+ChunkCache::~ChunkCache() {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        stopWriter = true;
+    }
+    pendingCv.notify_all();
+    writer.join();
+
+    std::lock_guard<std::mutex> lock(regionsMutex);
+    for (auto &it : regions)
+        CloseRegion(*it.second);
+    regions.clear();
+}
+
+ChunkCache::RecordKey ChunkCache::ColumnKey(int chunkX, int chunkZ) {
+    unsigned int key = (RecordType::Column << 16) | ((chunkZ & 31) << 5) | (chunkX & 31);
+    return RecordKey{ chunkX >> 5, chunkZ >> 5, key };
+}
+
+ChunkCache::RecordKey ChunkCache::MeshKey(const Vector &sectionPos) {
+    unsigned int key = (RecordType::Mesh << 16) | ((sectionPos.y & 15) << 10) | ((sectionPos.z & 31) << 5) | (sectionPos.x & 31);
+    return RecordKey{ sectionPos.x >> 5, sectionPos.z >> 5, key };
+}
+
+//Offsets are updated only if the rewritten file replaced the old one
+static bool RewriteRegion(const std::string &path, std::fstream &file, std::map<unsigned int, size_t> &offsets, const std::map<unsigned int, size_t> &sizes) {
+    std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(CacheMagic, sizeof(CacheMagic));
+    out.write(reinterpret_cast<const char *>(&CacheFormatVersion), sizeof(CacheFormatVersion));
+
+    std::map<unsigned int, size_t> newOffsets;
+    std::vector<char> buffer;
+    for (auto &it : offsets) {
+        size_t size = sizes.at(it.first);
+        buffer.resize(size);
+        file.seekg(it.second);
+        file.read(buffer.data(), size);
+        newOffsets[it.first] = out.tellp();
+        out.write(buffer.data(), size);
+    }
+    bool written = file && out;
+    out.close();
+    file.close();
+
+    std::error_code ec;
+    if (written)
+        fs::rename(tmpPath, path, ec);
+    if (!written || ec) {
+        LOG(ERROR) << "Chunk cache region not compacted " << path << ": " << (written ? ec.message() : "not written");
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    offsets = std::move(newOffsets);
+    return true;
+}
+
+ChunkCache::Region *ChunkCache::GetRegion(int regionX, int regionZ) {
+    auto it = regions.find(std::make_pair(regionX, regionZ));
+    if (it != regions.end())
+        return it->second.get();
+
+    auto region = std::make_unique<Region>();
+    region->path = (fs::path(directory) / ("r." + std::to_string(regionX) + "." + std::to_string(regionZ))).string();
+
+    bool valid = false;
+    if (fs::exists(region->path)) {
+        region->file.open(region->path, std::ios::in | std::ios::out | std::ios::binary);
+        char magic[sizeof(CacheMagic)] = {};
+        unsigned int version = 0;
+        region->file.read(magic, sizeof(magic));
+        region->file.read(reinterpret_cast<char *>(&version), sizeof(version));
+        valid = region->file && std::memcmp(magic, CacheMagic, sizeof(CacheMagic)) == 0 && version == CacheFormatVersion;
+        if (!valid)
+            region->file.close();
+    }
+
+    if (!valid) {
+        std::ofstream create(region->path, std::ios::binary | std::ios::trunc);
+        create.write(CacheMagic, sizeof(CacheMagic));
+        create.write(reinterpret_cast<const char *>(&CacheFormatVersion), sizeof(CacheFormatVersion));
+        create.close();
+        region->file.open(region->path, std::ios::in | std::ios::out | std::ios::binary);
+    }
+
+    if (!region->file) {
+        LOG(ERROR) << "Chunk cache region not opened " << region->path;
+        return nullptr;
+    }
+
+    region->file.seekg(0, std::ios::end);
+    size_t fileSize = region->file.tellg();
+    size_t offset = FileHeaderSize;
+    while (offset + RecordHeaderSize <= fileSize) {
+        unsigned int header[3];
+        region->file.seekg(offset);
+        region->file.read(reinterpret_cast<char *>(header), sizeof(header));
+        size_t recordSize = RecordHeaderSize + header[1];
+        if (!region->file || offset + recordSize > fileSize)
+            break;
+
+        auto prev = region->index.find(header[0]);
+        if (prev != region->index.end()) {
+            region->staleBytes += prev->second.size;
+            region->liveBytes -= prev->second.size;
+        }
+        region->index[header[0]] = RecordInfo{ offset, recordSize };
+        region->liveBytes += recordSize;
+        offset += recordSize;
+    }
+    region->file.clear();
+
+    if (offset != fileSize) {
+        LOG(WARNING) << "Chunk cache region " << region->path << " has truncated tail, compacting";
+        region->staleBytes = region->liveBytes + 1;
+        CloseRegion(*region);
+        region->file.open(region->path, std::ios::in | std::ios::out | std::ios::binary);
+    }
+
+    return regions.emplace(std::make_pair(regionX, regionZ), std::move(region)).first->second.get();
+}
+
+void ChunkCache::CloseRegion(Region &region) {
+    if (region.staleBytes > region.liveBytes) {
+        std::map<unsigned int, size_t> offsets, sizes;
+        for (auto &it : region.index) {
+            offsets[it.first] = it.second.offset;
+            sizes[it.first] = it.second.size;
+        }
+        if (RewriteRegion(region.path, region.file, offsets, sizes)) {
+            for (auto &it : region.index)
+                it.second.offset = offsets[it.first];
+            region.staleBytes = 0;
+        }
+    }
+    region.file.close();
+}
+
+void ChunkCache::WriterFunction() {
+    std::unique_lock<std::mutex> lock(pendingMutex);
+    while (true) {
+        pendingCv.wait(lock, [this] { return stopWriter || !writeQueue.empty(); });
+        if (writeQueue.empty())
+            break;
+
+        auto [key, recordSequence] = writeQueue.front();
+        writeQueue.pop_front();
+        auto it = pending.find(key);
+        if (it == pending.end() || it->second.sequence != recordSequence)
+            continue;
+        auto data = it->second.data;
+        lock.unlock();
+
+        std::vector<unsigned char> compressed;
+        if (!Compress(*data, compressed)) {
+            LOG(ERROR) << "Chunk cache record not compressed, skipped";
+            lock.lock();
+            it = pending.find(key);
+            if (it != pending.end() && it->second.sequence == recordSequence)
+                pending.erase(it);
+            continue;
+        }
+        unsigned int header[3] = { key.key, static_cast<unsigned int>(compressed.size()), static_cast<unsigned int>(data->size()) };
+        {
+            std::lock_guard<std::mutex> regionsLock(regionsMutex);
+            Region *region = GetRegion(key.regionX, key.regionZ);
+            if (region) {
+                region->file.seekp(0, std::ios::end);
+                size_t offset = region->file.tellp();
+                region->file.write(reinterpret_cast<const char *>(header), sizeof(header));
+                region->file.write(reinterpret_cast<const char *>(compressed.data()), compressed.size());
+                region->file.flush();
+
+                auto prev = region->index.find(key.key);
+                if (prev != region->index.end()) {
+                    region->staleBytes += prev->second.size;
+                    region->liveBytes -= prev->second.size;
+                }
+                region->index[key.key] = RecordInfo{ offset, RecordHeaderSize + compressed.size() };
+                region->liveBytes += RecordHeaderSize + compressed.size();
+            }
+        }
+
+        lock.lock();
+        it = pending.find(key);
+        if (it != pending.end() && it->second.sequence == recordSequence)
+            pending.erase(it);
+    }
+}
+
+void ChunkCache::Store(const RecordKey &key, std::vector<unsigned char> &&data) {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        size_t recordSequence = ++sequence;
+        pending[key] = PendingRecord{ recordSequence, std::make_shared<std::vector<unsigned char>>(std::move(data)) };
+        writeQueue.emplace_back(key, recordSequence);
+    }
+    pendingCv.notify_one();
+}
+
+bool ChunkCache::Load(const RecordKey &key, std::vector<unsigned char> &data) {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        auto it = pending.find(key);
+        if (it != pending.end()) {
+            data = *it->second.data;
+            return true;
+        }
+    }
+
+    unsigned int header[3];
+    std::vector<unsigned char> compressed;
+    {
+        std::lock_guard<std::mutex> lock(regionsMutex);
+        Region *region = GetRegion(key.regionX, key.regionZ);
+        if (!region)
+            return false;
+        auto it = region->index.find(key.key);
+        if (it == region->index.end())
+            return false;
+
+        region->file.seekg(it->second.offset);
+        region->file.read(reinterpret_cast<char *>(header), sizeof(header));
+        compressed.resize(header[1]);
+        region->file.read(reinterpret_cast<char *>(compressed.data()), compressed.size());
+        if (!region->file) {
+            region->file.clear();
+            LOG(ERROR) << "Chunk cache record not readed from " << region->path;
+            return false;
+        }
+    }
+
+    data.resize(header[2]);
+    uLongf dataSize = data.size();
+    if (uncompress(data.data(), &dataSize, compressed.data(), compressed.size()) != Z_OK || dataSize != data.size()) {
+        LOG(ERROR) << "Chunk cache record corrupted";
+        return false;
+    }
+    return true;
+}
+
+static unsigned char MeshFlags(bool smoothLighting, int lod) {
+    return (smoothLighting ? 1 : 0) | (lod << 1);
+}
+
+//Section hash first, then its neighbours, which decide border faces, smooth lighting and corner occlusion
+static std::array<unsigned long long, 27> MeshHashes(const SectionsData &sections) {
+    std::array<unsigned long long, 27> hashes;
+    hashes[0] = sections.data[1][1][1].GetHash();
+    size_t i = 1;
+    for (int x = 0; x < 3; x++) {
+        for (int y = 0; y < 3; y++) {
+            for (int z = 0; z < 3; z++) {
+                if (x != 1 || y != 1 || z != 1)
+                    hashes[i++] = sections.data[x][y][z].GetHash();
+            }
+        }
+    }
+    return hashes;
+}
+
+bool ChunkCache::LoadColumn(int chunkX, int chunkZ, std::vector<Section> &sections) {
+    OPTICK_EVENT();
+    std::vector<unsigned char> data;
+    if (!Load(ColumnKey(chunkX, chunkZ), data))
+        return false;
+
+    try {
+        StreamBuffer buffer(data.data(), data.size());
+        std::bitset<16> bitmask(buffer.ReadUShort());
+        for (int i = 0; i < 16; i++) {
+            if (bitmask[i])
+                sections.push_back(Section::Deserialize(&buffer, Vector(chunkX, i, chunkZ)));
+        }
+    } catch (std::exception &e) {
+        LOG(ERROR) << "Cached column " << chunkX << " " << chunkZ << " not parsed: " << e.what();
+        sections.clear();
+        return false;
+    }
+    return true;
+}
+
+void ChunkCache::StoreColumn(int chunkX, int chunkZ, const std::vector<std::shared_ptr<Section>> &sections) {
+    OPTICK_EVENT();
+    unsigned short bitmask = 0;
+    StreamCounter counter;
+    counter.WriteUShort(bitmask);
+    for (auto &section : sections) {
+        bitmask |= 1 << section->GetPosition().y;
+        section->Serialize(&counter);
+    }
+
+    StreamBuffer buffer(counter.GetCountedSize());
+    buffer.WriteUShort(bitmask);
+    for (auto &section : sections)
+        section->Serialize(&buffer);
+
+    Store(ColumnKey(chunkX, chunkZ), buffer.GetBuffer());
+}
+
+bool ChunkCache::LoadMesh(const SectionsData &sections, bool smoothLighting, int lod, RendererSectionData &data) {
+    OPTICK_EVENT();
+    Vector sectionPos = sections.data[1][1][1].GetPosition();
+    std::vector<unsigned char> raw;
+    if (!Load(MeshKey(sectionPos), raw))
+        return false;
+
+    std::array<unsigned long long, 27> hashes = MeshHashes(sections);
+    const size_t headerSize = sizeof(hashes) + 1 + 2 * sizeof(unsigned int);
+    if (raw.size() < headerSize)
+        return false;
+
+    unsigned int solidCount, liquidCount;
+    unsigned char storedFlags = raw[sizeof(hashes)];
+    std::memcpy(&solidCount, raw.data() + sizeof(hashes) + 1, sizeof(solidCount));
+    std::memcpy(&liquidCount, raw.data() + sizeof(hashes) + 1 + sizeof(solidCount), sizeof(liquidCount));
+
+    if (std::memcmp(raw.data(), hashes.data(), sizeof(hashes)) != 0 || storedFlags != MeshFlags(smoothLighting, lod))
+        return false;
+    if (raw.size() != headerSize + (solidCount + liquidCount) * sizeof(VertexData))
+        return false;
+
+    const VertexData *vertices = reinterpret_cast<const VertexData *>(raw.data() + headerSize);
+    data.solidVertices.assign(vertices, vertices + solidCount);
+    data.liquidVertices.assign(vertices + solidCount, vertices + solidCount + liquidCount);
+    data.hash = hashes[0];
+    data.sectionPos = sectionPos;
+    data.forced = false;
+    data.lod = lod;
+    return true;
+}
+
+void ChunkCache::StoreMesh(const SectionsData &sections, const RendererSectionData &data, bool smoothLighting) {
+    OPTICK_EVENT();
+    std::array<unsigned long long, 27> hashes = MeshHashes(sections);
+    unsigned int solidCount = data.solidVertices.size();
+    unsigned int liquidCount = data.liquidVertices.size();
+    const size_t headerSize = sizeof(hashes) + 1 + sizeof(solidCount) + sizeof(liquidCount);
+
+    std::vector<unsigned char> raw(headerSize + (solidCount + liquidCount) * sizeof(VertexData));
+    std::memcpy(raw.data(), hashes.data(), sizeof(hashes));
+    raw[sizeof(hashes)] = MeshFlags(smoothLighting, data.lod);
+    std::memcpy(raw.data() + sizeof(hashes) + 1, &solidCount, sizeof(solidCount));
+    std::memcpy(raw.data() + sizeof(hashes) + 1 + sizeof(solidCount), &liquidCount, sizeof(liquidCount));
+    std::memcpy(raw.data() + headerSize, data.solidVertices.data(), solidCount * sizeof(VertexData));
+    std::memcpy(raw.data() + headerSize + solidCount * sizeof(VertexData), data.liquidVertices.data(), liquidCount * sizeof(VertexData));
+
+    Store(MeshKey(data.sectionPos), std::move(raw));
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <fstream>
+#include <condition_variable>
+
+#include "Vector.hpp"
+#include "Section.hpp"
+
+struct RendererSectionData;
+struct SectionsData;
+
+/*
+ * Optional on-disk cache of received columns and baked section meshes.
+ * Data is stored per server and dimension in region files of 32x32 columns,
+ * every region file is an append-only log of records, the latest record for a key wins.
+ * Writes are compressed and appended by a background thread, loads are done synchronously on the caller thread,
+ * so meshes are loaded by the mesh workers and not by the render thread.
+ * Meshes are keyed by hashes of the section and all its neighbours, which decide border faces and lighting,
+ * so stale meshes are never returned.
+ */
+class ChunkCache {
+    enum RecordType : unsigned char {
+        Column = 0,
+        Mesh = 1,
+    };
+
+    struct RecordKey {
+        int regionX, regionZ;
+        unsigned int key;
+
+        bool operator<(const RecordKey &rhs) const {
+            return std::tie(regionX, regionZ, key) < std::tie(rhs.regionX, rhs.regionZ, rhs.key);
+        }
+    };
+
+    struct RecordInfo {
+        size_t offset;
+        size_t size;
+    };
+
+    struct Region {
+        std::fstream file;
+        std::string path;
+        std::map<unsigned int, RecordInfo> index;
+        size_t liveBytes = 0;
+        size_t staleBytes = 0;
+    };
+
+    struct PendingRecord {
+        size_t sequence;
+        std::shared_ptr<std::vector<unsigned char>> data;
+    };
+
+    std::string directory;
+
+    std::mutex regionsMutex;
+    std::map<std::pair<int, int>, std::unique_ptr<Region>> regions;
+
+    std::mutex pendingMutex;
+    std::condition_variable pendingCv;
+    std::map<RecordKey, PendingRecord> pending;
+    std::deque<std::pair<RecordKey, size_t>> writeQueue;
+    size_t sequence = 0;
+    bool stopWriter = false;
+    std::thread writer;
+
+    void WriterFunction();
+
+    Region *GetRegion(int regionX, int regionZ);
+
+    void CloseRegion(Region &region);
+
+    void Store(const RecordKey &key, std::vector<unsigned char> &&data);
+
+    bool Load(const RecordKey &key, std::vector<unsigned char> &data);
+
+    static RecordKey ColumnKey(int chunkX, int chunkZ);
+
+    static RecordKey MeshKey(const Vector &sectionPos);
+
+public:
+    ChunkCache(const std::string &serverName, int dimension);
+
+    ~ChunkCache();
+
+    ChunkCache(const ChunkCache &) = delete;
+
+    ChunkCache &operator=(const ChunkCache &) = delete;
+
+    bool LoadColumn(int chunkX, int chunkZ, std::vector<Section> &sections);
+
+    void StoreColumn(int chunkX, int chunkZ, const std::vector<std::shared_ptr<Section>> &sections);
+
+    bool LoadMesh(const SectionsData &sections, bool smoothLighting, int lod, RendererSectionData &data);
+
+    void StoreMesh(const SectionsData &sections, const RendererSectionData &data, bool smoothLighting);
+};
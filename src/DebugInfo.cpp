@@ -1,8 +1,63 @@
 #include "DebugInfo.hpp"
 
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
 std::atomic_int DebugInfo::totalSections(0);
 std::atomic_int DebugInfo::renderSections(0);
 std::atomic_int DebugInfo::readyRenderer(0);
 std::atomic_int DebugInfo::gameThreadTime(0);
 std::atomic_int DebugInfo::renderFaces(0);
 std::atomic_int DebugInfo::culledSections(0);
+std::atomic_int DebugInfo::physicsEntities(0);
+std::atomic_int DebugInfo::physicsStepTime(0);
+std::atomic_int DebugInfo::gpuFrameTime(0);
+std::atomic_int DebugInfo::meshesParsed(0);
+std::atomic_int DebugInfo::meshAllocations(0);
+
+#ifdef HOT_COUNTERS
+namespace {
+    std::mutex hotCountersMutex;
+    std::vector<std::atomic<uint64_t>*> threadHotCounters;
+    HotCountersSnapshot exitedThreadsHotCounters{};
+
+    struct HotCountersRetirer {
+        bool isActive = false;
+
+        ~HotCountersRetirer() {
+            if (!isActive)
+                return;
+            std::lock_guard<std::mutex> lock(hotCountersMutex);
+            for (size_t i = 0; i < exitedThreadsHotCounters.size(); i++)
+                exitedThreadsHotCounters[i] += HotCounters::counters[i].load(std::memory_order_relaxed);
+            threadHotCounters.erase(std::find(threadHotCounters.begin(), threadHotCounters.end(), HotCounters::counters));
+        }
+    };
+
+    thread_local HotCountersRetirer hotCountersRetirer;
+}
+
+thread_local std::atomic<uint64_t> HotCounters::counters[static_cast<size_t>(HotCounter::Count)];
+thread_local bool HotCounters::isRegistered = false;
+
+void HotCounters::Register() {
+    isRegistered = true;
+    std::lock_guard<std::mutex> lock(hotCountersMutex);
+    threadHotCounters.push_back(counters);
+    hotCountersRetirer.isActive = true;
+}
+#endif
+
+HotCountersSnapshot DebugInfo::GetHotCounters() {
+    HotCountersSnapshot snapshot{};
+#ifdef HOT_COUNTERS
+    std::lock_guard<std::mutex> lock(hotCountersMutex);
+    snapshot = exitedThreadsHotCounters;
+    for (std::atomic<uint64_t> *counters : threadHotCounters) {
+        for (size_t i = 0; i < snapshot.size(); i++)
+            snapshot[i] += counters[i].load(std::memory_order_relaxed);
+    }
+#endif
+    return snapshot;
+}
@@ -1,6 +1,28 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+
+//Hot path counters, counted only in builds with HOT_COUNTERS defined
+enum class HotCounter : size_t {
+    SectionGetBlockId,
+    SectionPaletteMiss, //block value is not in the section palette
+    WorldGetSectionPtr,
+    GetBlockInfo,
+    MeshJobsStarted,
+    MeshJobsCancelled, //removed from the parse queue before meshing
+    MeshJobsDiscarded, //meshed, but the section did not change meanwhile
+    MeshFaces,
+    MeshUnpackNs,
+    MeshVisibilityNs,
+    MeshFacesNs,
+    MeshLightingNs,
+    Count,
+};
+
+using HotCountersSnapshot = std::array<uint64_t, static_cast<size_t>(HotCounter::Count)>;
 
 struct DebugInfo {
     static std::atomic_int totalSections;
@@ -9,4 +31,52 @@ struct DebugInfo {
     static std::atomic_int readyRenderer;
     static std::atomic_int gameThreadTime;
 	static std::atomic_int renderFaces;
+    static std::atomic_int physicsEntities;
+    static std::atomic_int physicsStepTime; //microseconds
+    static std::atomic_int gpuFrameTime; //microseconds, sum of GpuTimer scopes
+    static std::atomic_int meshesParsed;
+    static std::atomic_int meshAllocations; //meshing buffers grown, ideally stops increasing
+
+    //Sums of hot counters of all threads since start, zeros without HOT_COUNTERS
+    static HotCountersSnapshot GetHotCounters();
 };
+
+#ifdef HOT_COUNTERS
+/*
+ * Every thread counts into its own counters, so counting is a plain load and store
+ * without cache line sharing. Counters are registered on the first use in a thread and
+ * folded into totals when the thread exits.
+ */
+namespace HotCounters {
+    extern thread_local std::atomic<uint64_t> counters[static_cast<size_t>(HotCounter::Count)];
+    extern thread_local bool isRegistered;
+
+    void Register();
+
+    inline void Add(HotCounter counter, uint64_t value) {
+        if (!isRegistered)
+            Register();
+        std::atomic<uint64_t> &count = counters[static_cast<size_t>(counter)];
+        count.store(count.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    class ScopeTimer {
+        HotCounter counter;
+        std::chrono::steady_clock::time_point start;
+    public:
+        ScopeTimer(HotCounter counter) : counter(counter), start(std::chrono::steady_clock::now()) {}
+
+        ~ScopeTimer() {
+            Add(counter, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+    };
+}
+
+#define HOT_COUNT(counter) HotCounters::Add(HotCounter::counter, 1)
+#define HOT_COUNT_ADD(counter, value) HotCounters::Add(HotCounter::counter, value)
+#define HOT_SCOPE_TIME(counter) HotCounters::ScopeTimer hotScopeTimer##counter(HotCounter::counter)
+#else
+#define HOT_COUNT(counter)
+#define HOT_COUNT_ADD(counter, value)
+#define HOT_SCOPE_TIME(counter)
+#endif
@@ -1,5 +1,34 @@
 #include "Entity.hpp"
 
+void Entity::SetServerPosition(const VectorF &position, bool teleport) {
+    //Server sends entity moves every tick, delta of a long pause is not a velocity
+    const double minUpdateInterval = 0.05;
+    const double maxUpdateInterval = 0.25;
+    if (!teleport && simulation == SimulationMode::Remote && serverPosAge <= maxUpdateInterval)
+        vel = (position - serverPos) * (1.0 / _max(serverPosAge, minUpdateInterval));
+    else if (teleport)
+        vel = VectorF(0, 0, 0);
+
+    serverPos = position;
+    serverPosAge = 0;
+    if (teleport || simulation == SimulationMode::Local)
+        pos = position;
+}
+
+void Entity::Extrapolate(double delta) {
+    const double maxExtrapolation = 0.1;
+    const double snapDistance = 4.0;
+    const double correctionRate = 15.0;
+
+    serverPosAge += delta;
+    VectorF target = serverPos + vel * _min(serverPosAge, maxExtrapolation);
+    if ((target - pos).GetLength() > snapDistance) {
+        pos = target;
+        return;
+    }
+    pos = pos + (target - pos) * _min(1.0, delta * correctionRate);
+}
+
 VectorF Entity::DecodeVelocity(short x, short y, short z) {
     const float ticksPerSecond = 20;
     const double velMod = 1 / 8000.0;
@@ -27,6 +56,17 @@ double Entity::EncodePitch(double pitch) {
     return -pitch;
 }
 
+//Thrown and dropped objects follow simple ballistics, so client simulates them between server updates.
+//Gravity and drag are vanilla per tick values converted to seconds
+static void SetBallistic(Entity &entity, double size, double gravity, double drag) {
+    entity.simulation = SimulationMode::Local;
+    entity.width = size;
+    entity.height = size;
+    entity.gravity = gravity;
+    entity.drag = drag;
+    entity.onGround = false;
+}
+
 Entity CreateObject(ObjectType type) {
     Entity entity;
     entity.type = EntityType::Object;
@@ -34,28 +74,32 @@ Entity CreateObject(ObjectType type) {
         case ObjectType::Boat:        
             break;
         case ObjectType::ItemStack:
-            entity.width = 0.25;
-            entity.height = 0.25;
+            SetBallistic(entity, 0.25, 16.0, 0.4);
             break;
         case ObjectType::AreaEffectCloud:
             break;
         case ObjectType::Minecart:
             break;
         case ObjectType::ActivatedTNT:
+            SetBallistic(entity, 0.98, 16.0, 0.4);
             break;
         case ObjectType::EnderCrystal:
             break;
         case ObjectType::TippedArrow:
+            SetBallistic(entity, 0.5, 20.0, 0.2);
             break;
         case ObjectType::Snowball:
+            SetBallistic(entity, 0.25, 12.0, 0.2);
             break;
         case ObjectType::Egg:
+            SetBallistic(entity, 0.25, 12.0, 0.2);
             break;
         case ObjectType::FireBall:
             break;
         case ObjectType::FireCharge:
             break;
         case ObjectType::ThrownEnderpearl:
+            SetBallistic(entity, 0.25, 12.0, 0.2);
             break;
         case ObjectType::WitherSkull:
             break;
@@ -64,14 +108,17 @@ Entity CreateObject(ObjectType type) {
         case ObjectType::LlamaSpit:
             break;
         case ObjectType::FallingObjects:
+            SetBallistic(entity, 0.98, 16.0, 0.4);
             break;
         case ObjectType::Itemframes:
             break;
         case ObjectType::EyeOfEnder:
             break;
         case ObjectType::ThrownPotion:
+            SetBallistic(entity, 0.25, 20.0, 0.2);
             break;
         case ObjectType::ThrownExpBottle:
+            SetBallistic(entity, 0.25, 28.0, 0.2);
             break;
         case ObjectType::FireworkRocket:
             break;
@@ -84,6 +131,7 @@ Entity CreateObject(ObjectType type) {
         case ObjectType::FishingHook:
             break;
         case ObjectType::SpectralArrow:
+            SetBallistic(entity, 0.5, 20.0, 0.2);
             break;
         case ObjectType::DragonFireball:
             break;
@@ -124,6 +124,11 @@ enum MobType {
     EnderCrystal=200,
 };
 
+enum class SimulationMode {
+    Local, //full physics, the local player and client predicted objects
+    Remote, //moved by server, extrapolated between updates
+};
+
 struct Entity {
     Uuid uuid;
     VectorF pos = 0;
@@ -138,11 +143,21 @@ struct Entity {
     EntityType type = EntityType::Object;
     bool isSolid = true;
     double gravity = 32.0; // in m/s^2
-    double drag = 0.4;
+    double drag = 0.4; //horizontal velocity lost per second by local simulation
     double terminalVelocity = 78.4;
     bool onGround = true;
     VectorF EyeOffset = VectorF(0,1.62,0);
 	bool isFlying = false;
+    SimulationMode simulation = SimulationMode::Remote;
+    //Remote entities: last position sent by server and seconds since it
+    VectorF serverPos = 0;
+    double serverPosAge = 0;
+
+    //Teleports and local entities are snapped, remote moves are extrapolated to
+    void SetServerPosition(const VectorF &position, bool teleport);
+
+    //Moves remote entity along its velocity for a short time after server update
+    void Extrapolate(double delta);
 
     static VectorF DecodeVelocity(short x, short y, short z);
     static VectorF DecodeDeltaPos(short deltaX, short deltaY, short deltaZ);
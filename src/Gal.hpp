@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <string>
@@ -22,6 +23,11 @@ namespace Gal {
     struct Framebuffer;
     struct ShaderParametersBuffer;
     struct Shader;
+    struct GpuTimer;
+    struct UploadRing;
+    struct UploadAllocation;
+    struct BufferUpload;
+    struct UploadThread;
 
 
     enum class Type {
@@ -142,16 +148,40 @@ namespace Gal {
 
         virtual std::shared_ptr<ShaderParametersBuffer> GetGlobalShaderParameters() = 0;
 
+        virtual std::shared_ptr<ShaderParametersBuffer> CreateShaderParametersBuffer() = 0;
+
         virtual std::shared_ptr<Shader> LoadVertexShader(std::string_view code) = 0;
 
         virtual std::shared_ptr<Shader> LoadPixelShader(std::string_view code) = 0;
 
+
+        virtual std::shared_ptr<GpuTimer> GetGpuTimer() = 0;
+
+        //Returns nullptr if persistently mapped buffers are not supported
+        virtual std::shared_ptr<UploadRing> GetUploadRing() = 0;
+
+        //makeContextCurrent is called on the new thread and binds a context sharing objects with the render context,
+        //releaseContext unbinds it on the same thread before the thread exits
+        virtual void StartUploadThread(std::function<bool()> makeContextCurrent, std::function<void()> releaseContext) = 0;
+
+        //Joins the upload thread, must be called before the upload context is destroyed
+        virtual void StopUploadThread() = 0;
+
+        //Returns nullptr if the upload thread is not started
+        virtual std::shared_ptr<UploadThread> GetUploadThread() = 0;
+
     };
 
     struct Buffer {
         virtual ~Buffer() = default;
 
         virtual void SetData(std::vector<std::byte>&& data) = 0;
+
+        //GPU side copy of the allocation, the allocation can be freed right after the call
+        virtual void SetData(UploadRing &ring, const UploadAllocation &allocation) = 0;
+
+        //GPU side concatenation of the first size bytes of every source buffer
+        virtual void CopyData(const std::vector<std::pair<std::shared_ptr<Buffer>, size_t>> &sources) = 0;
     };
 
     struct BufferBinding {
@@ -179,6 +209,11 @@ namespace Gal {
         virtual void SetData(std::vector<std::byte>&& data, size_t mipLevel = 0) = 0;
 
         virtual void SetSubData(size_t x, size_t y, size_t z, size_t width, size_t height, size_t depth, std::vector<std::byte> &&data, size_t mipLevel = 0) = 0;
+
+        //Kept until FlushSubData, which stages every queued rectangle in one pixel buffer and uploads them grouped by layer
+        virtual void QueueSubData(size_t x, size_t y, size_t z, size_t width, size_t height, size_t depth, std::vector<std::byte> &&data, size_t mipLevel = 0) = 0;
+
+        virtual void FlushSubData() = 0;
     };
 
     struct PipelineConfig {
@@ -192,6 +227,8 @@ namespace Gal {
 
         virtual void AddStaticTexture(std::string_view name, std::shared_ptr<Texture> texture) = 0;
 
+        virtual void AddShaderParametersBuffer(std::string_view name, std::shared_ptr<ShaderParametersBuffer> buffer) = 0;
+
         virtual void SetTarget(std::shared_ptr<Framebuffer> target) = 0;
 
         virtual void SetPrimitive(Primitive primitive) = 0;
@@ -287,4 +324,77 @@ namespace Gal {
     struct Shader {
         virtual ~Shader() = default;
     };
+
+    /*
+     * GPU time of named render passes, measured with timer queries.
+     * Queries of a frame are read back frames later, so measuring never waits for the GPU.
+     * Scopes do not nest, beginning a scope ends the active one.
+     */
+    struct GpuTimer {
+        virtual ~GpuTimer() = default;
+
+        virtual void SetEnabled(bool enabled) = 0;
+
+        virtual bool IsEnabled() = 0;
+
+        //Called once per frame before the first scope, collects finished results of earlier frames
+        virtual void BeginFrame() = 0;
+
+        virtual void BeginScope(std::string_view name) = 0;
+
+        virtual void EndScope() = 0;
+
+        //Milliseconds of GPU time per scope name, in order of the scopes in frame
+        virtual const std::vector<std::pair<std::string, double>> &GetResults() = 0;
+    };
+
+    struct UploadAllocation {
+        std::byte *data = nullptr;
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
+    /*
+     * Persistently mapped staging memory for buffer uploads.
+     * Any thread can allocate and write into the allocation, the render thread copies it
+     * into buffers and frees it. Freed memory is reused after the GPU passes the fence of the frame.
+     */
+    struct UploadRing {
+        virtual ~UploadRing() = default;
+
+        //Thread safe, data is nullptr if there is not enough free space
+        virtual UploadAllocation Allocate(size_t size) = 0;
+
+        virtual void Free(const UploadAllocation &allocation) = 0;
+
+        //Called once per frame after the last copy, fences memory freed in the frame
+        virtual void EndFrame() = 0;
+    };
+
+    /*
+     * Buffers filled by the upload thread. The upload thread fences its commands,
+     * IsReady polls the fence, so the render thread never waits for the upload.
+     */
+    struct BufferUpload {
+        virtual ~BufferUpload() = default;
+
+        //Render thread only
+        virtual bool IsReady() = 0;
+
+        //Buffers in order of the uploaded data, valid once after IsReady returned true
+        virtual std::vector<std::shared_ptr<Buffer>> TakeBuffers() = 0;
+    };
+
+    /*
+     * Thread with its own context, creates and fills buffers outside of the frame.
+     */
+    struct UploadThread {
+        virtual ~UploadThread() = default;
+
+        //Thread safe. Data is read on the upload thread and must stay valid until the upload is ready
+        virtual std::shared_ptr<BufferUpload> UploadBuffers(std::vector<std::pair<const std::byte*, size_t>> &&data) = 0;
+
+        //Blocks until every queued upload was submitted, afterwards uploaded data is not read anymore
+        virtual void Flush() = 0;
+    };
 }
@@ -1,5 +1,14 @@
 #include "Gal.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
 #include <easylogging++.h>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
@@ -14,6 +23,7 @@ struct ImplOgl;
 struct ShaderOgl;
 struct FramebufferOgl;
 struct ShaderParametersBufferOgl;
+struct UploadThreadOgl;
 
 class OglState {
     GLuint activeFbo = 0;
@@ -209,9 +219,300 @@ public:
     }
 };
 
+struct GpuTimerOgl : public GpuTimer {
+    //Frames a query set is in flight before it is read back and reused
+    static constexpr size_t framesInFlight = 2;
+
+    struct FrameQueries {
+        std::vector<GLuint> queries;
+        std::vector<std::string> names;
+    };
+
+    FrameQueries frames[framesInFlight];
+    size_t currentFrame = 0;
+    size_t usedQueries = 0;
+    bool isScopeActive = false;
+    bool isEnabled = false;
+    std::vector<std::pair<std::string, double>> results;
+
+    ~GpuTimerOgl() {
+        for (auto &frame : frames) {
+            if (!frame.queries.empty())
+                glDeleteQueries(frame.queries.size(), frame.queries.data());
+        }
+    }
+
+    virtual void SetEnabled(bool enabled) override {
+        if (isScopeActive)
+            EndScope();
+        isEnabled = enabled;
+        if (!enabled)
+            results.clear();
+    }
+
+    virtual bool IsEnabled() override {
+        return isEnabled;
+    }
+
+    virtual void BeginFrame() override {
+        if (!isEnabled)
+            return;
+        if (isScopeActive)
+            EndScope();
+        frames[currentFrame].names.resize(usedQueries);
+
+        currentFrame = (currentFrame + 1) % framesInFlight;
+        usedQueries = 0;
+
+        //Frame being reused was issued framesInFlight frames ago, unfinished results are dropped instead of waited for
+        FrameQueries &frame = frames[currentFrame];
+        if (frame.names.empty())
+            return;
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.names.size() - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+
+        results.clear();
+        for (size_t i = 0; i < frame.names.size(); i++) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed);
+            auto it = std::find_if(results.begin(), results.end(), [&](const auto &result) { return result.first == frame.names[i]; });
+            if (it != results.end())
+                it->second += elapsed / 1000000.0;
+            else
+                results.emplace_back(frame.names[i], elapsed / 1000000.0);
+        }
+        frame.names.clear();
+        glCheckError();
+    }
+
+    virtual void BeginScope(std::string_view name) override {
+        if (!isEnabled)
+            return;
+        if (isScopeActive)
+            EndScope();
+
+        FrameQueries &frame = frames[currentFrame];
+        if (usedQueries == frame.queries.size()) {
+            GLuint query;
+            glGenQueries(1, &query);
+            frame.queries.push_back(query);
+        }
+        if (frame.names.size() <= usedQueries)
+            frame.names.resize(usedQueries + 1);
+        frame.names[usedQueries] = name;
+        glBeginQuery(GL_TIME_ELAPSED, frame.queries[usedQueries]);
+        usedQueries++;
+        isScopeActive = true;
+        glCheckError();
+    }
+
+    virtual void EndScope() override {
+        if (!isScopeActive)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        isScopeActive = false;
+        glCheckError();
+    }
+
+    virtual const std::vector<std::pair<std::string, double>> &GetResults() override {
+        return results;
+    }
+};
+
+struct UploadRingOgl : public UploadRing {
+    static constexpr size_t ringSize = 32 * 1024 * 1024;
+    static constexpr size_t alignment = 16;
+
+    struct Range {
+        size_t offset;
+        size_t size;
+        bool isReusable;
+    };
+
+    struct FrameFence {
+        GLsync sync;
+        std::vector<size_t> offsets;
+    };
+
+    GlResource vbo;
+    std::byte *mapped = nullptr;
+
+    std::mutex mutex;
+    std::deque<Range> ranges; //in order of allocation, memory between the first range and head is in use
+    size_t head = 0;
+    std::vector<size_t> freedInFrame;
+    std::deque<FrameFence> fences;
+
+    UploadRingOgl() {
+        GLuint newVbo;
+        glGenBuffers(1, &newVbo);
+        vbo = GlResource(newVbo, GlResourceType::Vbo);
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, ringSize, nullptr, flags);
+        mapped = reinterpret_cast<std::byte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, ringSize, flags));
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glCheckError();
+    }
+
+    ~UploadRingOgl() {
+        for (auto &fence : fences)
+            glDeleteSync(fence.sync);
+    }
+
+    virtual UploadAllocation Allocate(size_t size) override {
+        size = (size + alignment - 1) / alignment * alignment;
+        if (!mapped || size == 0 || size > ringSize)
+            return {};
+
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t offset;
+        if (ranges.empty()) {
+            offset = 0;
+        } else {
+            size_t tail = ranges.front().offset;
+            if (head > tail) {
+                if (ringSize - head >= size)
+                    offset = head;
+                else if (tail >= size)
+                    offset = 0;
+                else
+                    return {};
+            } else if (tail - head >= size) {
+                offset = head;
+            } else {
+                return {};
+            }
+        }
+        ranges.push_back(Range{ offset, size, false });
+        head = offset + size;
+        return UploadAllocation{ mapped + offset, offset, size };
+    }
+
+    virtual void Free(const UploadAllocation &allocation) override {
+        if (!allocation.data)
+            return;
+        freedInFrame.push_back(allocation.offset);
+    }
+
+    virtual void EndFrame() override {
+        if (!freedInFrame.empty()) {
+            fences.push_back(FrameFence{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(freedInFrame) });
+            freedInFrame.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!fences.empty()) {
+            GLenum status = glClientWaitSync(fences.front().sync, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                break;
+            for (size_t offset : fences.front().offsets) {
+                auto it = std::find_if(ranges.begin(), ranges.end(), [offset](const Range &range) {
+                    return range.offset == offset && !range.isReusable;
+                });
+                if (it != ranges.end())
+                    it->isReusable = true;
+            }
+            glDeleteSync(fences.front().sync);
+            fences.pop_front();
+        }
+        while (!ranges.empty() && ranges.front().isReusable)
+            ranges.pop_front();
+        if (ranges.empty())
+            head = 0;
+        glCheckError();
+    }
+};
+
+/*
+ * Pixel buffers texture data is staged in before the texture is filled from them,
+ * so the driver copies it to the texture asynchronously instead of from client memory.
+ * A buffer is reused after the GPU passed the fence of its last upload.
+ */
+struct TextureStagingOgl {
+
+    struct StagingBuffer {
+        GlResource pbo;
+        size_t capacity = 0;
+        GLsync sync = nullptr;
+    };
+
+    std::vector<StagingBuffer> buffers;
+    size_t active = 0;
+
+    ~TextureStagingOgl() {
+        for (auto &buffer : buffers) {
+            if (buffer.sync)
+                glDeleteSync(buffer.sync);
+        }
+    }
+
+    //Binds a free buffer of at least size bytes as pixel unpack buffer, returns nullptr if it can't be mapped
+    std::byte *Map(size_t size) {
+        active = buffers.size();
+        for (size_t i = 0; i < buffers.size(); i++) {
+            StagingBuffer &buffer = buffers[i];
+            if (buffer.sync) {
+                GLenum status = glClientWaitSync(buffer.sync, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                    continue;
+                glDeleteSync(buffer.sync);
+                buffer.sync = nullptr;
+            }
+            //Smallest buffer fitting the data, otherwise the biggest one is grown
+            bool fits = buffer.capacity >= size;
+            if (active == buffers.size() ||
+                (fits && (buffers[active].capacity < size || buffer.capacity < buffers[active].capacity)) ||
+                (!fits && buffers[active].capacity < size && buffer.capacity > buffers[active].capacity))
+                active = i;
+        }
+        if (active == buffers.size()) {
+            GLuint newPbo;
+            glGenBuffers(1, &newPbo);
+            buffers.push_back(StagingBuffer{ GlResource(newPbo, GlResourceType::Vbo), 0, nullptr });
+        }
+
+        StagingBuffer &buffer = buffers[active];
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+        if (buffer.capacity < size) {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            buffer.capacity = size;
+        }
+        void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        glCheckError();
+        if (!mapped)
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return reinterpret_cast<std::byte*>(mapped);
+    }
+
+    //Buffer stays bound, texture calls take offsets into it as data pointers
+    void Unmap() {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    //Called after the texture calls reading the buffer
+    void Release() {
+        buffers[active].sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glCheckError();
+    }
+};
+
 std::unique_ptr<ImplOgl> impl;
 std::shared_ptr<FramebufferOgl> fbDefault;
 std::shared_ptr<ShaderParametersBufferOgl> spbDefault;
+std::shared_ptr<GpuTimerOgl> gpuTimer;
+std::shared_ptr<UploadRingOgl> uploadRing;
+std::shared_ptr<UploadThreadOgl> uploadThread;
+std::unique_ptr<TextureStagingOgl> textureStaging;
+
+TextureStagingOgl &GetTextureStaging() {
+    if (!textureStaging)
+        textureStaging = std::make_unique<TextureStagingOgl>();
+    return *textureStaging;
+}
 
 size_t GalTypeGetComponents(Gal::Type type) {
     switch (type) {
@@ -674,6 +975,184 @@ struct BufferOgl : public Buffer {
         glCheckError();
     }
 
+    virtual void SetData(UploadRing &ring, const UploadAllocation &allocation) override {
+        auto &ringOgl = static_cast<UploadRingOgl&>(ring);
+        glBindBuffer(GL_COPY_READ_BUFFER, ringOgl.vbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+        glBufferData(GL_COPY_WRITE_BUFFER, allocation.size, nullptr, GL_STATIC_DRAW);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.offset, 0, allocation.size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glCheckError();
+    }
+
+    virtual void CopyData(const std::vector<std::pair<std::shared_ptr<Buffer>, size_t>> &sources) override {
+        size_t totalSize = 0;
+        for (const auto &source : sources)
+            totalSize += source.second;
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+        glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STATIC_DRAW);
+        size_t offset = 0;
+        for (const auto &source : sources) {
+            if (!source.second)
+                continue;
+            glBindBuffer(GL_COPY_READ_BUFFER, static_cast<BufferOgl&>(*source.first).vbo);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, source.second);
+            offset += source.second;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glCheckError();
+    }
+
+};
+
+struct BufferUploadOgl : public BufferUpload {
+
+    std::vector<std::pair<const std::byte*, size_t>> data;
+    std::vector<GLuint> vbos; //owned until taken by the render thread
+    GLsync sync = nullptr;
+    std::atomic<bool> isSubmitted{ false };
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    bool isReady = false;
+
+    ~BufferUploadOgl() {
+        if (sync)
+            glDeleteSync(sync);
+        if (!vbos.empty())
+            glDeleteBuffers(vbos.size(), vbos.data());
+    }
+
+    virtual bool IsReady() override {
+        if (isReady)
+            return true;
+        if (!isSubmitted.load(std::memory_order_acquire))
+            return false;
+        GLenum status = glClientWaitSync(sync, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            return false;
+        glDeleteSync(sync);
+        sync = nullptr;
+
+        for (GLuint vbo : vbos) {
+            auto buff = std::make_shared<BufferOgl>();
+            buff->vbo = GlResource(vbo, GlResourceType::Vbo);
+            buffers.push_back(std::static_pointer_cast<Buffer, BufferOgl>(buff));
+        }
+        vbos.clear();
+        isReady = true;
+        return true;
+    }
+
+    virtual std::vector<std::shared_ptr<Buffer>> TakeBuffers() override {
+        return std::move(buffers);
+    }
+
+};
+
+struct UploadThreadOgl : public UploadThread {
+
+    std::function<bool()> makeContextCurrent;
+    std::function<void()> releaseContext;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<BufferUploadOgl>> queue;
+    bool isStarted = false;
+    bool isRunning = true;
+    bool isBusy = false;
+
+    //Returns after the thread tried to bind its context, isRunning is false if it failed
+    UploadThreadOgl(std::function<bool()> makeCurrent, std::function<void()> release) : makeContextCurrent(std::move(makeCurrent)), releaseContext(std::move(release)) {
+        thread = std::thread(&UploadThreadOgl::ThreadFunction, this);
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return isStarted; });
+    }
+
+    ~UploadThreadOgl() {
+        Stop();
+    }
+
+    //Returns after the thread released its context, so the context can be destroyed
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isRunning = false;
+        }
+        cv.notify_all();
+        if (thread.joinable())
+            thread.join();
+    }
+
+    virtual std::shared_ptr<BufferUpload> UploadBuffers(std::vector<std::pair<const std::byte*, size_t>> &&data) override {
+        auto upload = std::make_shared<BufferUploadOgl>();
+        upload->data = std::move(data);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(upload);
+        }
+        cv.notify_all();
+        return std::static_pointer_cast<BufferUpload, BufferUploadOgl>(upload);
+    }
+
+    virtual void Flush() override {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return (queue.empty() && !isBusy) || !isRunning; });
+    }
+
+    void ThreadFunction() {
+        OPTICK_THREAD("Upload");
+        el::Helpers::setThreadName("Upload");
+        bool hasContext = makeContextCurrent();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isStarted = true;
+            isRunning = hasContext;
+        }
+        cv.notify_all();
+        if (!hasContext)
+            return;
+
+        while (true) {
+            std::shared_ptr<BufferUploadOgl> upload;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                isBusy = false;
+                cv.notify_all();
+                cv.wait(lock, [this] { return !queue.empty() || !isRunning; });
+                if (!isRunning)
+                    break;
+                upload = std::move(queue.front());
+                queue.pop_front();
+                isBusy = true;
+            }
+
+            OPTICK_EVENT("Upload buffers");
+            upload->vbos.resize(upload->data.size());
+            glGenBuffers(upload->vbos.size(), upload->vbos.data());
+            for (size_t i = 0; i < upload->data.size(); i++) {
+                glBindBuffer(GL_ARRAY_BUFFER, upload->vbos[i]);
+                glBufferData(GL_ARRAY_BUFFER, upload->data[i].second, upload->data[i].first, GL_STATIC_DRAW);
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            upload->data.clear();
+            upload->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            //Fence is visible to the render context only after it was flushed
+            glFlush();
+            glCheckError();
+            upload->isSubmitted.store(true, std::memory_order_release);
+        }
+
+        releaseContext();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.clear();
+        }
+        cv.notify_all();
+    }
+
 };
 
 struct TextureConfigOgl : public TextureConfig {
@@ -707,25 +1186,30 @@ struct TextureConfigOgl : public TextureConfig {
 
 struct TextureOgl : public Texture {
 
+    //Smaller uploads are copied from client memory right away
+    static constexpr size_t stagingThreshold = 64 * 1024;
+
+    struct QueuedSubData {
+        size_t x, y, z, w, h, d;
+        size_t mipLevel;
+        std::vector<std::byte> data;
+    };
+
     GLenum type;
     GlResource texture;
     Format format;
     size_t width, height, depth;
     bool linear;
+    std::vector<QueuedSubData> queuedSubData;
 
     virtual std::tuple<size_t, size_t, size_t> GetSize() override {
         return { width, height, depth };
     }
 
-    virtual void SetData(std::vector<std::byte>&& data, size_t mipLevel = 0) override {
-        size_t expectedSize = width * height * depth * GalFormatGetSize(format);
-        if (data.size() != expectedSize && !data.empty())
-            throw std::logic_error("Size of data is not valid for this texture");
-
+    //Texture must be bound, pixels is an offset into the bound pixel unpack buffer if there is one
+    void TexImage(size_t mipLevel, const void *pixels) {
         GLenum internalFormat = linear ? GalFormatGetGlLinearInternalFormat(format) : GalFormatGetGlInternalFormat(format);
 
-        oglState.BindTexture(type, texture);
-
         switch (type) {
         case GL_TEXTURE_1D:
         case GL_PROXY_TEXTURE_1D:
@@ -743,29 +1227,21 @@ struct TextureOgl : public Texture {
         case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
         case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
         case GL_PROXY_TEXTURE_CUBE_MAP:
-            glTexImage2D(type, mipLevel, internalFormat, width, height, 0, GalFormatGetGlFormat(format), GalFormatGetGlType(format), data.empty() ? nullptr : data.data());
+            glTexImage2D(type, mipLevel, internalFormat, width, height, 0, GalFormatGetGlFormat(format), GalFormatGetGlType(format), pixels);
             break;
         case GL_TEXTURE_3D:
         case GL_PROXY_TEXTURE_3D:
         case GL_TEXTURE_2D_ARRAY:
         case GL_PROXY_TEXTURE_2D_ARRAY:
-            glTexImage3D(type, mipLevel, internalFormat, width, height, depth, 0, GalFormatGetGlFormat(format), GalFormatGetGlType(format), data.empty() ? nullptr : data.data());
+            glTexImage3D(type, mipLevel, internalFormat, width, height, depth, 0, GalFormatGetGlFormat(format), GalFormatGetGlType(format), pixels);
             break;
         default:
             throw std::runtime_error("Unknown texture type");
         }
-
-        glCheckError();
-        oglState.BindTexture(type, 0);
     }
 
-    virtual void SetSubData(size_t x, size_t y, size_t z, size_t w, size_t h, size_t d, std::vector<std::byte>&& data, size_t mipLevel = 0) override {
-        size_t expectedSize = w * h * d * GalFormatGetSize(format);
-        if (data.size() != expectedSize)
-            throw std::logic_error("Size of data is not valid for this texture");
-
-        oglState.BindTexture(type, texture);
-
+    //Texture must be bound, pixels is an offset into the bound pixel unpack buffer if there is one
+    void TexSubImage(size_t x, size_t y, size_t z, size_t w, size_t h, size_t d, size_t mipLevel, const void *pixels) {
         switch (type) {
         case GL_TEXTURE_1D:
         case GL_PROXY_TEXTURE_1D:
@@ -783,20 +1259,113 @@ struct TextureOgl : public Texture {
         case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
         case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
         case GL_PROXY_TEXTURE_CUBE_MAP:
-            glTexSubImage2D(type, mipLevel, x, y, w, h, GalFormatGetGlFormat(format), GalFormatGetGlType(format), data.data());
+            glTexSubImage2D(type, mipLevel, x, y, w, h, GalFormatGetGlFormat(format), GalFormatGetGlType(format), pixels);
             break;
         case GL_TEXTURE_3D:
         case GL_PROXY_TEXTURE_3D:
         case GL_TEXTURE_2D_ARRAY:
         case GL_PROXY_TEXTURE_2D_ARRAY:
-            glTexSubImage3D(type, mipLevel, x, y, z, w, h, d, GalFormatGetGlFormat(format), GalFormatGetGlType(format), data.data());
+            glTexSubImage3D(type, mipLevel, x, y, z, w, h, d, GalFormatGetGlFormat(format), GalFormatGetGlType(format), pixels);
             break;
         default:
             throw std::runtime_error("Unknown texture type");
         }
+    }
+
+    virtual void SetData(std::vector<std::byte>&& data, size_t mipLevel = 0) override {
+        size_t expectedSize = width * height * depth * GalFormatGetSize(format);
+        if (data.size() != expectedSize && !data.empty())
+            throw std::logic_error("Size of data is not valid for this texture");
+
+        if (data.size() < stagingThreshold) {
+            oglState.BindTexture(type, texture);
+            TexImage(mipLevel, data.empty() ? nullptr : data.data());
+            glCheckError();
+            oglState.BindTexture(type, 0);
+            return;
+        }
+
+        oglState.BindTexture(type, texture);
+        TexImage(mipLevel, nullptr);
+        oglState.BindTexture(type, 0);
+        QueueSubData(0, 0, 0, width, height, depth, std::move(data), mipLevel);
+        FlushSubData();
+    }
+
+    //Allocates level 0 filled with zeros, so parts that are never written do not show undefined memory through filtering
+    void SetZeroData() {
+        if (!GLEW_ARB_clear_texture) {
+            SetData(std::vector<std::byte>(width * height * depth * GalFormatGetSize(format)));
+            return;
+        }
+        SetData({});
+        glClearTexImage(texture, 0, GalFormatGetGlFormat(format), GalFormatGetGlType(format), nullptr);
+        glCheckError();
+    }
+
+    virtual void SetSubData(size_t x, size_t y, size_t z, size_t w, size_t h, size_t d, std::vector<std::byte>&& data, size_t mipLevel = 0) override {
+        size_t expectedSize = w * h * d * GalFormatGetSize(format);
+        if (data.size() != expectedSize)
+            throw std::logic_error("Size of data is not valid for this texture");
+
+        if (data.size() >= stagingThreshold) {
+            QueueSubData(x, y, z, w, h, d, std::move(data), mipLevel);
+            FlushSubData();
+            return;
+        }
+
+        oglState.BindTexture(type, texture);
+        TexSubImage(x, y, z, w, h, d, mipLevel, data.data());
+        glCheckError();
+        oglState.BindTexture(type, 0);
+    }
+
+    virtual void QueueSubData(size_t x, size_t y, size_t z, size_t w, size_t h, size_t d, std::vector<std::byte> &&data, size_t mipLevel = 0) override {
+        size_t expectedSize = w * h * d * GalFormatGetSize(format);
+        if (data.size() != expectedSize)
+            throw std::logic_error("Size of data is not valid for this texture");
+
+        queuedSubData.push_back(QueuedSubData{ x, y, z, w, h, d, mipLevel, std::move(data) });
+    }
+
+    virtual void FlushSubData() override {
+        if (queuedSubData.empty())
+            return;
+        OPTICK_EVENT();
+
+        std::stable_sort(queuedSubData.begin(), queuedSubData.end(), [](const QueuedSubData &lhs, const QueuedSubData &rhs) {
+            return std::tie(lhs.mipLevel, lhs.z) < std::tie(rhs.mipLevel, rhs.z);
+        });
+
+        constexpr size_t alignment = 16;
+        std::vector<size_t> offsets;
+        offsets.reserve(queuedSubData.size());
+        size_t size = 0;
+        for (const auto &subData : queuedSubData) {
+            offsets.push_back(size);
+            size += (subData.data.size() + alignment - 1) / alignment * alignment;
+        }
 
+        oglState.BindTexture(type, texture);
+        TextureStagingOgl &staging = GetTextureStaging();
+        std::byte *mapped = staging.Map(size);
+        if (mapped) {
+            for (size_t i = 0; i < queuedSubData.size(); i++)
+                std::memcpy(mapped + offsets[i], queuedSubData[i].data.data(), queuedSubData[i].data.size());
+            staging.Unmap();
+            for (size_t i = 0; i < queuedSubData.size(); i++) {
+                const QueuedSubData &subData = queuedSubData[i];
+                TexSubImage(subData.x, subData.y, subData.z, subData.w, subData.h, subData.d, subData.mipLevel, reinterpret_cast<const void*>(offsets[i]));
+            }
+            staging.Release();
+        } else {
+            for (const auto &subData : queuedSubData)
+                TexSubImage(subData.x, subData.y, subData.z, subData.w, subData.h, subData.d, subData.mipLevel, subData.data.data());
+        }
         glCheckError();
         oglState.BindTexture(type, 0);
+
+        queuedSubData.clear();
     }
 
 };
@@ -866,6 +1435,7 @@ struct PipelineConfigOgl : public PipelineConfig {
 
     std::shared_ptr<ShaderOgl> vertexShader, pixelShader;
     std::map<std::string, std::shared_ptr<TextureOgl>> textures;
+    std::map<std::string, std::shared_ptr<ShaderParametersBufferOgl>> shaderParametersBuffers;
     std::map<std::string, Type> shaderParameters;
     std::shared_ptr<FramebufferOgl> targetFb;
     std::vector<std::vector<VertexAttribute>> vertexBuffers;
@@ -889,6 +1459,11 @@ struct PipelineConfigOgl : public PipelineConfig {
         textures.try_emplace(std::string(name), tex);
     }
 
+    virtual void AddShaderParametersBuffer(std::string_view name, std::shared_ptr<ShaderParametersBuffer> buffer) override {
+        auto spb = std::static_pointer_cast<ShaderParametersBufferOgl, ShaderParametersBuffer>(buffer);
+        shaderParametersBuffers.try_emplace(std::string(name), spb);
+    }
+
     virtual void SetTarget(std::shared_ptr<Framebuffer> target) override {
         auto fb = std::static_pointer_cast<FramebufferOgl, Framebuffer>(target);
         targetFb = fb;
@@ -971,6 +1546,7 @@ struct PipelineInstanceOgl : public PipelineInstance {
 
 struct PipelineOgl : public Pipeline {
     std::vector<std::shared_ptr<ShaderParametersBufferOgl>> spbs;
+    std::vector<std::pair<GLuint, std::shared_ptr<ShaderParametersBufferOgl>>> spbBindings; //binding point is shared between pipelines, so rebind on activation
     std::map<std::string, size_t> shaderParameters;
     std::vector<std::shared_ptr<TextureOgl>> staticTextures;
     GlResource program;
@@ -1006,6 +1582,10 @@ struct PipelineOgl : public Pipeline {
                 spb->dirty = false;
             }
         }
+
+        for (auto& [bindingPoint, spb] : spbBindings) {
+            glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, spb->buffer->vbo);
+        }
     }
 
     virtual void SetDynamicTexture(std::string_view name, std::shared_ptr<Texture> texture) override {
@@ -1166,7 +1746,8 @@ struct ImplOgl : public Impl {
         glFrontFace(GL_CCW);
 
         oglState.EnableBlending(true);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        //Destination alpha is kept, G-buffer stores ssao mask in color alpha under blended liquids
+        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE);
         glCheckError();
         if (glActiveTexture == nullptr) {
             throw std::runtime_error("GLEW initialization failed with unknown reason");
@@ -1188,6 +1769,10 @@ struct ImplOgl : public Impl {
 
     virtual void DeInit() override {
         LOG(INFO) << "Destroying Gal:OpenGL...";
+        gpuTimer.reset();
+        uploadRing.reset();
+        uploadThread.reset();
+        textureStaging.reset();
         glCheckError();
     }
 
@@ -1273,7 +1858,7 @@ struct ImplOgl : public Impl {
         glTexParameteri(texture->type, GL_TEXTURE_WRAP_T, GalWrappingGetGlType(texConfig->wrap));
 
         oglState.BindTexture(texture->type, 0);
-        texture->SetData(std::vector<std::byte>(texture->width * texture->height * texture->depth * GalFormatGetSize(texture->format)));
+        texture->SetZeroData();
         glCheckError();
 
         return std::static_pointer_cast<Texture, TextureOgl>(texture);
@@ -1373,6 +1958,20 @@ struct ImplOgl : public Impl {
             LOG(ERROR) << "Cannot bind Globals UBO to shader. Maybe uniform block Globals missing?";
         glCheckError();
 
+        GLuint spbBindingPoint = spbGlobalsBind + 1;
+        for (auto&& [name, spb] : config->shaderParametersBuffers) {
+            GLuint blockIndex = glGetUniformBlockIndex(program, name.c_str());
+            if (blockIndex == GL_INVALID_INDEX) {
+                LOG(ERROR) << "Uniform block \"" << name << "\" not found in shader";
+                continue;
+            }
+            glUniformBlockBinding(program, blockIndex, spbBindingPoint);
+            pipeline->spbs.emplace_back(spb);
+            pipeline->spbBindings.emplace_back(spbBindingPoint, spb);
+            spbBindingPoint++;
+        }
+        glCheckError();
+
 
         /*
         * Shader parameters
@@ -1510,6 +2109,12 @@ struct ImplOgl : public Impl {
         return spbDefault;
     }
 
+    virtual std::shared_ptr<ShaderParametersBuffer> CreateShaderParametersBuffer() override {
+        auto spb = std::make_shared<ShaderParametersBufferOgl>();
+        spb->buffer = std::static_pointer_cast<BufferOgl, Buffer>(GetImplementation()->CreateBuffer());
+        return std::static_pointer_cast<ShaderParametersBuffer, ShaderParametersBufferOgl>(spb);
+    }
+
     virtual std::shared_ptr<Shader> LoadVertexShader(std::string_view code) override {
         auto shader = std::make_shared<ShaderOgl>();
         shader->code = code;
@@ -1524,6 +2129,42 @@ struct ImplOgl : public Impl {
         return std::static_pointer_cast<Shader, ShaderOgl>(shader);
     }
 
+
+    virtual std::shared_ptr<GpuTimer> GetGpuTimer() override {
+        if (!gpuTimer)
+            gpuTimer = std::make_shared<GpuTimerOgl>();
+        return std::static_pointer_cast<GpuTimer, GpuTimerOgl>(gpuTimer);
+    }
+
+    virtual std::shared_ptr<UploadRing> GetUploadRing() override {
+        if (!GLEW_ARB_buffer_storage)
+            return nullptr;
+        if (!uploadRing)
+            uploadRing = std::make_shared<UploadRingOgl>();
+        return std::static_pointer_cast<UploadRing, UploadRingOgl>(uploadRing);
+    }
+
+    virtual void StartUploadThread(std::function<bool()> makeContextCurrent, std::function<void()> releaseContext) override {
+        if (uploadThread)
+            return;
+        uploadThread = std::make_shared<UploadThreadOgl>(std::move(makeContextCurrent), std::move(releaseContext));
+        if (!uploadThread->isRunning) {
+            LOG(WARNING) << "Upload context can't be made current, buffers are uploaded by the render thread";
+            uploadThread.reset();
+        }
+    }
+
+    virtual void StopUploadThread() override {
+        //Renderers may still hold the thread, it is joined here anyway
+        if (uploadThread)
+            uploadThread->Stop();
+        uploadThread.reset();
+    }
+
+    virtual std::shared_ptr<UploadThread> GetUploadThread() override {
+        return std::static_pointer_cast<UploadThread, UploadThreadOgl>(uploadThread);
+    }
+
 };
 
 Impl* Gal::GetImplementation()
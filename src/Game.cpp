@@ -1,6 +1,8 @@
 #include "Game.hpp"
 
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 
 #include <optick.h>
 
@@ -8,6 +10,7 @@
 #include "GameState.hpp"
 #include "NetworkClient.hpp"
 #include "Plugin.hpp"
+#include "Settings.hpp"
 
 bool isRunning = true;
 bool isMoving[5] = { 0,0,0,0,0 };
@@ -18,6 +21,61 @@ std::unique_ptr<Render> render;
 std::unique_ptr<LoopExecutionTimeController> timer;
 EventListener listener;
 
+bool pipelinedRendering = false;
+bool lateInputSampling = false;
+
+/*
+ * Runs GameState::Update on its own thread, so the frame prepared from the
+ * previous game state is drawn while the next game state is computed.
+ */
+class GameUpdateThread {
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cv;
+	double deltaTime = 0.0;
+	bool hasWork = false;
+	bool isStopping = false;
+
+	void ThreadFunction() {
+		OPTICK_THREAD("GameUpdate");
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			cv.wait(lock, [this] { return hasWork || isStopping; });
+			if (isStopping)
+				return;
+			lock.unlock();
+			gs->Update(deltaTime);
+			lock.lock();
+			hasWork = false;
+			cv.notify_all();
+		}
+	}
+
+public:
+	GameUpdateThread() : thread(&GameUpdateThread::ThreadFunction, this) {}
+
+	~GameUpdateThread() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			isStopping = true;
+		}
+		cv.notify_all();
+		thread.join();
+	}
+
+	void Start(double deltaTime) {
+		std::lock_guard<std::mutex> lock(mutex);
+		this->deltaTime = deltaTime;
+		hasWork = true;
+		cv.notify_all();
+	}
+
+	void Wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [this] { return !hasWork; });
+	}
+};
+
 std::thread connThread;
 std::unique_ptr<NetworkClient> connNc;
 std::unique_ptr<GameState> connGs;
@@ -37,7 +95,7 @@ void ConnectionThreadExec() {
 		}
 		LOG(INFO) << "Connecting to server at address " + std::get<0>(data) + ":" + std::to_string(std::get<1>(data)) + " as " + std::get<2>(data);
 		PUSH_EVENT("Connecting", 0);
-		connGs = std::make_unique<GameState>();
+		connGs = std::make_unique<GameState>(std::get<0>(data) + "_" + std::to_string(std::get<1>(data)));
 		try {
 			connNc = std::make_unique<NetworkClient>(std::get<0>(data),
 				std::get<1>(data),
@@ -94,6 +152,11 @@ void InitEvents() {
 		isRunning = false;
 		});
 
+	listener.RegisterHandler("SettingsUpdate", [](const Event&) {
+		pipelinedRendering = Settings::ReadBool("pipelinedRendering", false);
+		lateInputSampling = Settings::ReadBool("lateInputSampling", false);
+		});
+
 	listener.RegisterHandler("Disconnected", [](const Event&) {
 		if (!gs)
 			return;
@@ -171,13 +234,6 @@ void InitEvents() {
 		gs->HandleRotation(std::get<0>(data),std::get<1>(data));
 		});
 
-	listener.RegisterHandler("ReceivedPacket", [](const Event& eventData) {
-		if (!gs)
-			return;
-		std::shared_ptr<Packet> packet = eventData.get<std::shared_ptr<Packet>>();
-		gs->UpdatePacket(packet);
-		});
-
 	listener.RegisterHandler("LmbPressed",[](const Event& eventData) {
 		if (!gs)
 			return;
@@ -208,17 +264,30 @@ void RunGame() {
 	OPTICK_THREAD("Main");
 	InitEvents();
 
-	timer = std::make_unique<LoopExecutionTimeController>(std::chrono::milliseconds(16));
+	timer = std::make_unique<LoopExecutionTimeController>(std::chrono::milliseconds(16), true);
 
 	render = std::make_unique<Render>(900, 480, "AltCraft");
 
 	connThread = std::thread(ConnectionThreadExec);
 
+	pipelinedRendering = Settings::ReadBool("pipelinedRendering", false);
+	lateInputSampling = Settings::ReadBool("lateInputSampling", false);
+	GameUpdateThread gameUpdateThread;
+	std::vector<std::shared_ptr<Packet>> receivedPackets;
+
 	SetState(State::MainMenu);	
 
 	while (isRunning) {
 		OPTICK_FRAME("MainThread");		
+		//Input read right after the frame pacer wait is applied to the game state of this frame
+		if (lateInputSampling)
+			render->PollInput();
 		listener.HandleAllEvents();
+		if (gs && nc) {
+			nc->GetInbox().Swap(receivedPackets);
+			for (auto &packet : receivedPackets)
+				gs->UpdatePacket(packet);
+		}
 		PluginSystem::CallOnTick(timer->GetRealDeltaS());
 		if (gs) {
 			if (GetState() == State::Playing) {
@@ -233,9 +302,17 @@ void RunGame() {
 				if (isMoving[GameState::JUMP])
 					gs->HandleMovement(GameState::JUMP, timer->GetRealDeltaS());
 			}			
-			gs->Update(timer->GetRealDeltaS());
 		}
-		render->Update();
+		if (gs && pipelinedRendering) {
+			render->PrepareFrame();
+			gameUpdateThread.Start(timer->GetRealDeltaS());
+			render->RenderFrame();
+			gameUpdateThread.Wait();
+		} else {
+			if (gs)
+				gs->Update(timer->GetRealDeltaS());
+			render->Update();
+		}
 		timer->Update();
 	}
 
@@ -1,5 +1,7 @@
 #include "GameState.hpp"
 
+#include <algorithm>
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <easylogging++.h>
 #include <optick.h>
@@ -8,6 +10,29 @@
 #include "Packet.hpp"
 #include "Game.hpp"
 #include "Plugin.hpp"
+#include "Settings.hpp"
+#include "ChunkCache.hpp"
+
+GameState::GameState(const std::string &serverName) : serverName(serverName) {
+
+}
+
+GameState::~GameState() {
+	world.StoreToCache();
+}
+
+void GameState::CreateWorld(int dimension) {
+	world.StoreToCache();
+	world = World(dimension);
+	if (!serverName.empty() && Settings::ReadBool("chunkCache", false)) {
+		try {
+			world.SetCache(std::make_shared<ChunkCache>(serverName, dimension));
+		}
+		catch (std::exception &e) {
+			LOG(ERROR) << "Chunk cache not created: " << e.what();
+		}
+	}
+}
 
 void GameState::Update(double deltaTime) {
 	OPTICK_EVENT();
@@ -44,6 +69,8 @@ void GameState::Update(double deltaTime) {
 		timeOfPreviousSendedPacket = clock.now();
 	}
 
+	world.UpdatePendingEdits();
+
 	bool prevOnGround = player->onGround;
 	world.UpdatePhysics(deltaTime);
 	if (player->onGround != prevOnGround) {
@@ -92,7 +119,7 @@ void GameState::UpdatePacket(std::shared_ptr<Packet> ptr) {
 			auto packet = std::static_pointer_cast<PacketSpawnObject>(ptr);
 			Entity entity = CreateObject(static_cast<ObjectType>(packet->Type));
 			entity.entityId = packet->EntityId;
-			entity.pos = VectorF(packet->X, packet->Y, packet->Z);
+			entity.SetServerPosition(VectorF(packet->X, packet->Y, packet->Z), true);
 			entity.uuid = packet->ObjectUuid;
 			entity.vel = Entity::DecodeVelocity(packet->VelocityX, packet->VelocityY, packet->VelocityZ);
 			entity.yaw = packet->Yaw / 256.0;
@@ -113,7 +140,7 @@ void GameState::UpdatePacket(std::shared_ptr<Packet> ptr) {
 			auto packet = std::static_pointer_cast<PacketSpawnMob>(ptr);
 			Entity entity;
 			entity.entityId = packet->EntityId;
-			entity.pos = VectorF(packet->X, packet->Y, packet->Z);
+			entity.SetServerPosition(VectorF(packet->X, packet->Y, packet->Z), true);
 			entity.uuid = packet->EntityUuid;
 			entity.vel = Entity::DecodeVelocity(packet->VelocityX, packet->VelocityY, packet->VelocityZ);
 			entity.yaw = packet->Yaw / 256.0;
@@ -131,7 +158,7 @@ void GameState::UpdatePacket(std::shared_ptr<Packet> ptr) {
 			auto packet = std::static_pointer_cast<PacketSpawnPlayer>(ptr);
 			Entity entity;
 			entity.entityId = packet->EntityId;
-			entity.pos = VectorF(packet->X, packet->Y, packet->Z);
+			entity.SetServerPosition(VectorF(packet->X, packet->Y, packet->Z), true);
 			entity.uuid = packet->PlayerUuid;
 			entity.yaw = packet->Yaw / 256.0;
 			entity.pitch = packet->Pitch / 256.0;
@@ -272,7 +299,9 @@ void GameState::UpdatePacket(std::shared_ptr<Packet> ptr) {
 			entity.entityId = packet->EntityId;
 			entity.width = 0.6;
 			entity.height = 1.8;
-			world = World(packet->Dimension);
+			entity.drag = 10.0;
+			entity.simulation = SimulationMode::Local;
+			CreateWorld(packet->Dimension);
 			world.AddEntity(entity);
 			player = world.GetEntityPtr(entity.entityId);
 
@@ -307,14 +336,14 @@ void GameState::UpdatePacket(std::shared_ptr<Packet> ptr) {
 		case EntityRelativeMove: {
 			auto packet = std::static_pointer_cast<PacketEntityRelativeMove>(ptr);
 			Entity &entity = world.GetEntity(packet->EntityId);
-			entity.pos = entity.pos + Entity::DecodeDeltaPos(packet->DeltaX, packet->DeltaY, packet->DeltaZ);
+			entity.SetServerPosition(entity.serverPos + Entity::DecodeDeltaPos(packet->DeltaX, packet->DeltaY, packet->DeltaZ), false);
 			break;
 		}
 
 		case EntityLookAndRelativeMove: {
 			auto packet = std::static_pointer_cast<PacketEntityLookAndRelativeMove>(ptr);
 			Entity &entity = world.GetEntity(packet->EntityId);
-			entity.pos = entity.pos + Entity::DecodeDeltaPos(packet->DeltaX, packet->DeltaY, packet->DeltaZ);
+			entity.SetServerPosition(entity.serverPos + Entity::DecodeDeltaPos(packet->DeltaX, packet->DeltaY, packet->DeltaZ), false);
 			entity.pitch = packet->Pitch / 256.0;
 			entity.yaw = packet->Yaw / 256.0;
 			break;
@@ -378,6 +407,11 @@ void GameState::UpdatePacket(std::shared_ptr<Packet> ptr) {
 				player->pos.z = packet->Z;
 			}
 
+			if (!gameStatus.isGameStarted) {
+				int radius = Settings::ReadDouble("renderDistance", 2.0f);
+				world.LoadCachedColumns(std::floor(player->pos.x / 16.0), std::floor(player->pos.z / 16.0), radius);
+			}
+
 			PUSH_EVENT("PlayerPosChanged", player->pos);
 			LOG(INFO) << "PlayerPos is " << player->pos << "\t\tAngle: " << player->yaw << "," << player->pitch;;
 
@@ -411,7 +445,9 @@ void GameState::UpdatePacket(std::shared_ptr<Packet> ptr) {
 			entity.entityId = player->entityId;
 			entity.width = 0.6;
 			entity.height = 1.8;
-			world = World(packet->Dimension);
+			entity.drag = 10.0;
+			entity.simulation = SimulationMode::Local;
+			CreateWorld(packet->Dimension);
 			world.AddEntity(entity);
 			player = world.GetEntityPtr(entity.entityId);
 
@@ -500,7 +536,7 @@ void GameState::UpdatePacket(std::shared_ptr<Packet> ptr) {
 		case EntityTeleport: {
 			auto packet = std::static_pointer_cast<PacketEntityTeleport>(ptr);
 			Entity &entity = world.GetEntity(packet->EntityId);
-			entity.pos = VectorF(packet->X, packet->Y, packet->Z);
+			entity.SetServerPosition(VectorF(packet->X, packet->Y, packet->Z), true);
 			entity.pitch = packet->Pitch / 256.0;
 			entity.yaw = packet->Yaw / 256.0;
 			break;
@@ -614,6 +650,27 @@ glm::mat4 GameState::GetViewMatrix() {
 	return glm::lookAt(eyePos, eyePos + front, up);
 }
 
+RenderSnapshot GameState::CreateRenderSnapshot() {
+	OPTICK_EVENT();
+	RenderSnapshot snapshot;
+	snapshot.view = GetViewMatrix();
+	snapshot.playerPos = player->pos;
+	snapshot.selectedBlock = selectionStatus.selectedBlock;
+	snapshot.raycastHit = selectionStatus.raycastHit;
+	snapshot.interpolatedTimeOfDay = timeStatus.interpolatedTimeOfDay;
+
+	std::vector<unsigned int> entitiesList = world.GetEntitiesList();
+	snapshot.entities.reserve(entitiesList.size());
+	for (unsigned int entityId : entitiesList) {
+		const Entity &entity = world.GetEntity(entityId);
+		snapshot.entities.push_back({ entityId, entity.pos, entity.width, entity.height, entity.renderColor });
+	}
+	std::sort(snapshot.entities.begin(), snapshot.entities.end(), [](const auto &lhs, const auto &rhs) {
+		return lhs.entityId < rhs.entityId;
+	});
+	return snapshot;
+}
+
 // TODO: it should actually be something like this:
 //    function start_digging():
 //        send_packet(packet_type=start_digging_packet)
@@ -633,6 +690,8 @@ void GameState::FinishDigging() {
 	auto packetFinish = std::make_shared<PacketPlayerDigging>(2, selectionStatus.selectedBlock, 1);
 	auto packet = std::static_pointer_cast<Packet>(packetFinish);
 	PUSH_EVENT("SendPacket", packet);
+
+	world.PredictBlockId(selectionStatus.selectedBlock, BlockId{ 0, 0 });
 }
 
 // TODO: it should actually be something like this:
@@ -685,6 +744,21 @@ void GameState::PlaceBlock() {
 
 	auto packet = std::static_pointer_cast<Packet>(packetPlace);
 	PUSH_EVENT("SendPacket", packet);
+
+	//Server places the item of the first hotbar slot, item ids below 256 are blocks
+	const size_t hotbarSlot = 36;
+	if (playerInventory.slots.size() <= hotbarSlot)
+		return;
+	const SlotDataType &item = playerInventory.slots[hotbarSlot];
+	if (item.BlockId <= 0 || item.BlockId >= 256)
+		return;
+
+	static const Vector faceOffsets[] = {
+		Vector(0, -1, 0), Vector(0, 1, 0), Vector(0, 0, -1), Vector(0, 0, 1), Vector(-1, 0, 0), Vector(1, 0, 0)
+	};
+	Vector placePos = selectionStatus.selectedBlock + faceOffsets[face];
+	if (world.GetBlockId(placePos).id == 0)
+		world.PredictBlockId(placePos, BlockId{ static_cast<unsigned short>(item.BlockId), static_cast<unsigned char>(item.ItemDamage & 0xF) });
 }
 
 void GameState::PerformRespawn() {
@@ -10,6 +10,7 @@
 #include "Vector.hpp"
 #include "World.hpp"
 #include "Window.hpp"
+#include "RenderSnapshot.hpp"
 
 class Packet;
 class Entity;
@@ -77,8 +78,16 @@ class GameState {
 
 	std::shared_ptr<PacketRespawn> packetRespawn;
 
+	std::string serverName;
+
+	void CreateWorld(int dimension);
+
 public:
 
+	GameState(const std::string &serverName = "");
+
+	~GameState();
+
     void Update(double deltaTime);
 
     void UpdatePacket(std::shared_ptr<Packet> ptr);
@@ -103,6 +112,8 @@ public:
 
     glm::mat4 GetViewMatrix();
 
+	RenderSnapshot CreateRenderSnapshot();
+
 	inline Entity *GetPlayer() {
 		return player;
 	}
@@ -0,0 +1,144 @@
+#include "HudData.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+#include <easylogging++.h>
+#include <optick.h>
+#include <RmlUi/Core.h>
+
+#include "DebugInfo.hpp"
+#include "Game.hpp"
+#include "GameState.hpp"
+#include "Block.hpp"
+#include "Utility.hpp"
+#include "Gal.hpp"
+
+namespace {
+    template<typename... Args>
+    std::string Format(const char *format, Args... args) {
+        char buffer[128];
+        std::snprintf(buffer, sizeof(buffer), format, args...);
+        return buffer;
+    }
+}
+
+HudData::HudData(Rml::Context *context) {
+    Rml::DataModelConstructor constructor = context->CreateDataModel("hud");
+    if (!constructor) {
+        LOG(ERROR) << "Hud data model not created";
+        return;
+    }
+
+    constructor.Bind("fps", &values.fps);
+    constructor.Bind("pacing", &values.pacing);
+    constructor.Bind("pos", &values.pos);
+    constructor.Bind("selectPos", &values.selectPos);
+    constructor.Bind("selectBid", &values.selectBid);
+    constructor.Bind("selectName", &values.selectName);
+    constructor.Bind("selectLight", &values.selectLight);
+    constructor.Bind("sectionsLoaded", &values.sectionsLoaded);
+    constructor.Bind("sectionsRenderer", &values.sectionsRenderer);
+    constructor.Bind("sectionsReady", &values.sectionsReady);
+    constructor.Bind("sectionsCulled", &values.sectionsCulled);
+    constructor.Bind("renderedFaces", &values.renderedFaces);
+    constructor.Bind("physics", &values.physics);
+    constructor.Bind("meshing", &values.meshing);
+    constructor.Bind("meshJobs", &values.meshJobs);
+    constructor.Bind("hotPaths", &values.hotPaths);
+    constructor.Bind("gpu", &values.gpu);
+    constructor.Bind("hp", &values.hp);
+
+    handle = constructor.GetModelHandle();
+}
+
+void HudData::SetRefreshRate(double refreshRate) {
+    refreshInterval = 1.0 / _max(1.0, refreshRate);
+}
+
+void HudData::Update(double deltaS) {
+    sinceRefresh += deltaS;
+    framesSinceRefresh++;
+    if (sinceRefresh < refreshInterval || !handle)
+        return;
+
+    Refresh();
+
+    sinceRefresh = 0.0;
+    framesSinceRefresh = 0;
+}
+
+void HudData::Refresh() {
+    OPTICK_EVENT();
+    GameState *gs = GetGameState();
+    if (!gs || !gs->GetPlayer() || gs->GetTimeStatus().worldAge <= 0)
+        return;
+
+    Set("fps", values.fps, Format("%.1f", framesSinceRefresh / sinceRefresh));
+    LoopExecutionTimeController *time = GetTime();
+    Set("pacing", values.pacing, Format("%.2f / %.2f ms, jitter %.2f ms", time->GetPacingErrorMs(), time->GetPacingErrorMaxMs(), time->GetFrameJitterMs()));
+
+    const VectorF &playerPos = gs->GetPlayer()->pos;
+    Set("pos", values.pos, Format("%.1f %.1f %.1f", playerPos.x, playerPos.y, playerPos.z));
+
+    const SelectionStatus &selection = gs->GetSelectionStatus();
+    if (selection.isBlockSelected) {
+        const World &world = gs->GetWorld();
+        BlockId bid = world.GetBlockId(selection.selectedBlock);
+        BlockInfo *info = GetBlockInfo(bid);
+
+        std::ostringstream selectPos;
+        selectPos << selection.selectedBlock;
+        Set("selectPos", values.selectPos, selectPos.str());
+        Set("selectBid", values.selectBid, Format("%d:%d", bid.id, bid.state));
+        Set("selectName", values.selectName, info ? info->blockstate + ":" + info->variant : std::string());
+        Set("selectLight", values.selectLight, Format("%d:%d", world.GetBlockLight(selection.selectedBlock), world.GetBlockSkyLight(selection.selectedBlock)));
+    } else {
+        Set("selectPos", values.selectPos, std::string());
+        Set("selectBid", values.selectBid, std::string());
+        Set("selectName", values.selectName, std::string());
+        Set("selectLight", values.selectLight, std::string());
+    }
+
+    Set("sectionsLoaded", values.sectionsLoaded, DebugInfo::totalSections.load());
+    Set("sectionsRenderer", values.sectionsRenderer, DebugInfo::renderSections.load());
+    Set("sectionsReady", values.sectionsReady, DebugInfo::readyRenderer.load());
+    Set("sectionsCulled", values.sectionsCulled, DebugInfo::totalSections - DebugInfo::culledSections);
+    Set("renderedFaces", values.renderedFaces, DebugInfo::renderFaces.load());
+    Set("physics", values.physics, Format("%d entities, %.2f ms", DebugInfo::physicsEntities.load(), DebugInfo::physicsStepTime / 1000.0));
+
+    int meshes = DebugInfo::meshesParsed - meshesParsed;
+    int allocations = DebugInfo::meshAllocations - meshAllocations;
+    meshesParsed += meshes;
+    meshAllocations += allocations;
+    Set("meshing", values.meshing, Format("%d meshes, %.2f allocations per mesh", meshes, meshes ? static_cast<double>(allocations) / meshes : 0.0));
+
+#ifdef HOT_COUNTERS
+    HotCountersSnapshot counters = DebugInfo::GetHotCounters();
+    auto delta = [&](HotCounter counter) {
+        return static_cast<double>(counters[static_cast<size_t>(counter)] - hotCounters[static_cast<size_t>(counter)]);
+    };
+    double perMeshMs = meshes ? 1.0 / (meshes * 1000000.0) : 0.0;
+    Set("meshJobs", values.meshJobs, Format("%.0f started, %.0f cancelled, %.0f discarded, %.0f faces per mesh",
+        delta(HotCounter::MeshJobsStarted), delta(HotCounter::MeshJobsCancelled), delta(HotCounter::MeshJobsDiscarded),
+        meshes ? delta(HotCounter::MeshFaces) / meshes : 0.0) +
+        Format(", unpack %.3f, visibility %.3f, faces %.3f, lighting %.3f ms per mesh",
+        delta(HotCounter::MeshUnpackNs) * perMeshMs, delta(HotCounter::MeshVisibilityNs) * perMeshMs,
+        delta(HotCounter::MeshFacesNs) * perMeshMs, delta(HotCounter::MeshLightingNs) * perMeshMs));
+    Set("hotPaths", values.hotPaths, Format("GetBlockId %.0fk/s (%.0f palette misses), GetSectionPtr %.0fk/s, GetBlockInfo %.0fk/s",
+        delta(HotCounter::SectionGetBlockId) / sinceRefresh / 1000.0, delta(HotCounter::SectionPaletteMiss),
+        delta(HotCounter::WorldGetSectionPtr) / sinceRefresh / 1000.0, delta(HotCounter::GetBlockInfo) / sinceRefresh / 1000.0));
+    hotCounters = counters;
+#endif
+
+    auto gpuTimer = Gal::GetImplementation()->GetGpuTimer();
+    std::ostringstream gpu;
+    if (gpuTimer->IsEnabled()) {
+        gpu << Format("%.2f ms", DebugInfo::gpuFrameTime / 1000.0);
+        for (const auto &result : gpuTimer->GetResults())
+            gpu << ", " << result.first << Format(" %.2f", result.second);
+    }
+    Set("gpu", values.gpu, gpu.str());
+
+    Set("hp", values.hp, static_cast<int>(gs->GetPlayerStatus().health + 0.5f));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+
+#include "DebugInfo.hpp"
+
+#include <RmlUi/Core/DataModelHandle.h>
+
+namespace Rml
+{
+    class Context;
+}
+
+/*
+ * "hud" Rml data model with the debug overlay and player status.
+ * Values are gathered from DebugInfo and GameState at refreshRate,
+ * only changed values are marked dirty, so unchanged HUD parts are not laid out again.
+ */
+class HudData {
+    struct Values {
+        std::string fps;
+        std::string pacing;
+        std::string pos;
+        std::string selectPos;
+        std::string selectBid;
+        std::string selectName;
+        std::string selectLight;
+        int sectionsLoaded = 0;
+        int sectionsRenderer = 0;
+        int sectionsReady = 0;
+        int sectionsCulled = 0;
+        int renderedFaces = 0;
+        std::string physics;
+        std::string meshing;
+        std::string meshJobs;
+        std::string hotPaths;
+        std::string gpu;
+        int hp = 0;
+    } values;
+
+    Rml::DataModelHandle handle;
+    double refreshInterval = 0.1;
+    double sinceRefresh = 0.0;
+    size_t framesSinceRefresh = 0;
+    int meshesParsed = 0;
+    int meshAllocations = 0;
+    HotCountersSnapshot hotCounters{};
+
+    template<typename T>
+    void Set(const char *name, T &field, const T &value) {
+        if (field == value)
+            return;
+        field = value;
+        handle.DirtyVariable(name);
+    }
+
+    void Refresh();
+
+public:
+    HudData(Rml::Context *context);
+
+    HudData(const HudData &) = delete;
+
+    HudData &operator=(const HudData &) = delete;
+
+    void SetRefreshRate(double refreshRate);
+
+    void Update(double deltaS);
+};
@@ -0,0 +1,78 @@
+#include "JobPool.hpp"
+
+#include <optick.h>
+
+#include "Utility.hpp"
+
+JobPool::JobPool(size_t threadsCount) : threadsCount(threadsCount) {
+
+}
+
+JobPool::~JobPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    startCv.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void JobPool::RunRange(size_t rangeId) {
+    if (rangeId >= jobRanges)
+        return;
+    size_t begin = jobCount * rangeId / jobRanges;
+    size_t end = jobCount * (rangeId + 1) / jobRanges;
+    if (begin < end)
+        job(begin, end);
+}
+
+void JobPool::WorkerFunction(size_t workerId) {
+    OPTICK_THREAD("Job");
+    size_t seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        startCv.wait(lock, [&] { return isStopping || generation != seenGeneration; });
+        if (isStopping)
+            return;
+        seenGeneration = generation;
+        lock.unlock();
+
+        RunRange(workerId + 1);
+
+        lock.lock();
+        if (--pendingRanges == 0)
+            doneCv.notify_all();
+    }
+}
+
+void JobPool::ParallelFor(size_t count, size_t minRangeSize, std::function<void(size_t, size_t)> job) {
+    if (count == 0)
+        return;
+    size_t ranges = _min(GetRangesCount(), count / _max(minRangeSize, size_t(1)));
+    if (ranges < 2) {
+        job(0, count);
+        return;
+    }
+
+    if (workers.empty()) {
+        for (size_t i = 0; i < threadsCount; i++)
+            workers.emplace_back(&JobPool::WorkerFunction, this, i);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job = std::move(job);
+        jobCount = count;
+        jobRanges = ranges;
+        pendingRanges = workers.size();
+        generation++;
+    }
+    startCv.notify_all();
+
+    RunRange(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCv.wait(lock, [this] { return pendingRanges == 0; });
+    this->job = nullptr;
+}
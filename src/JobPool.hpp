@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * Persistent worker threads for data parallel loops.
+ * ParallelFor splits [0, count) into fixed contiguous ranges and blocks until all of
+ * them are done, the calling thread processes a range too. Ranges depend only on
+ * count, minimal range size and number of threads, so results of independent items are deterministic.
+ * Threads are started by the first loop big enough to be split.
+ */
+class JobPool {
+    size_t threadsCount;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCv;
+    std::condition_variable doneCv;
+    std::function<void(size_t, size_t)> job;
+    size_t jobCount = 0;
+    size_t jobRanges = 0;
+    size_t generation = 0;
+    size_t pendingRanges = 0;
+    bool isStopping = false;
+
+    void WorkerFunction(size_t workerId);
+
+    void RunRange(size_t rangeId);
+
+public:
+    JobPool(size_t threadsCount);
+
+    ~JobPool();
+
+    JobPool(const JobPool &) = delete;
+
+    JobPool &operator=(const JobPool &) = delete;
+
+    //Maximal number of ranges, workers plus the calling thread
+    size_t GetRangesCount() const {
+        return threadsCount + 1;
+    }
+
+    //Calls job(begin, end) for every range, ranges are not shorter than minRangeSize,
+    //so loops of fewer than two ranges are processed on the calling thread without waking workers
+    void ParallelFor(size_t count, size_t minRangeSize, std::function<void(size_t, size_t)> job);
+};
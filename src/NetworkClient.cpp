@@ -80,7 +80,7 @@ void NetworkClient::ExecNs() {
 			std::shared_ptr<Packet> packet = network->ReceivePacket(state, compressionThreshold >= 0);
 			if (packet != nullptr) {
 				if (packet->GetPacketId() != PacketNamePlayCB::KeepAliveCB) {
-					PUSH_EVENT("ReceivedPacket", packet);
+					inbox.Push(packet);
 				}
 				else {
 					timeOfLastKeepAlivePacket = std::chrono::steady_clock::now();
@@ -93,7 +93,7 @@ void NetworkClient::ExecNs() {
 			if (std::chrono::steady_clock::now() - timeOfLastKeepAlivePacket > 20s) {
 				packet = std::make_shared<PacketDisconnectPlay>();
 				std::static_pointer_cast<PacketDisconnectPlay>(packet)->Reason = "Timeout: server not respond";
-				PUSH_EVENT("ReceivedPacket", packet);
+				inbox.Push(packet);
 			}
 		}
 	} catch (std::exception &e) {
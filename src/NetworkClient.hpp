@@ -6,6 +6,8 @@
 #include <chrono>
 #include <thread>
 
+#include "PacketInbox.hpp"
+
 class Network;
 struct Packet;
 enum ConnectionState : unsigned char;
@@ -17,8 +19,13 @@ class NetworkClient {
     std::chrono::steady_clock::time_point timeOfLastKeepAlivePacket;
 	std::thread thread;
 	bool isRunning=true;
+	PacketInbox inbox;
 	void ExecNs();
 public:
 	NetworkClient(std::string address, unsigned short port, std::string username);
 	~NetworkClient();
+
+	PacketInbox &GetInbox() {
+		return inbox;
+	}
 };
@@ -0,0 +1,68 @@
+#include "PacketInbox.hpp"
+
+#include <limits>
+#include <map>
+
+#include <optick.h>
+
+#include "Packet.hpp"
+
+void PacketInbox::Push(std::shared_ptr<Packet> packet) {
+    std::lock_guard<std::mutex> lock(mutex);
+    back.push_back(std::move(packet));
+}
+
+void PacketInbox::Swap(std::vector<std::shared_ptr<Packet>> &batch) {
+    OPTICK_EVENT();
+    batch.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        back.swap(batch);
+    }
+    Coalesce(batch);
+}
+
+void PacketInbox::Coalesce(std::vector<std::shared_ptr<Packet>> &packets) {
+    auto fitsShort = [](int value) {
+        return value >= std::numeric_limits<short>::min() && value <= std::numeric_limits<short>::max();
+    };
+
+    //Entity id to the relative move further moves of the entity are merged into
+    std::map<int, PacketEntityRelativeMove*> moves;
+    size_t count = 0;
+    for (size_t i = 0; i < packets.size(); i++) {
+        Packet *packet = packets[i].get();
+        switch (packet->GetPacketId()) {
+            case PacketNamePlayCB::EntityRelativeMove: {
+                auto move = static_cast<PacketEntityRelativeMove*>(packet);
+                auto it = moves.find(move->EntityId);
+                if (it != moves.end()) {
+                    PacketEntityRelativeMove *target = it->second;
+                    int x = target->DeltaX + move->DeltaX;
+                    int y = target->DeltaY + move->DeltaY;
+                    int z = target->DeltaZ + move->DeltaZ;
+                    if (fitsShort(x) && fitsShort(y) && fitsShort(z)) {
+                        target->DeltaX = x;
+                        target->DeltaY = y;
+                        target->DeltaZ = z;
+                        target->OnGround = move->OnGround;
+                        continue;
+                    }
+                }
+                moves[move->EntityId] = move;
+                break;
+            }
+            //Rotation only, applied independently of positions
+            case PacketNamePlayCB::EntityLook:
+            case PacketNamePlayCB::EntityHeadLook:
+                break;
+            default:
+                moves.clear();
+                break;
+        }
+        if (count != i)
+            packets[count] = std::move(packets[i]);
+        count++;
+    }
+    packets.resize(count);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct Packet;
+
+/*
+ * Packets received by the network thread for the game thread.
+ * The network thread appends to the back buffer, the game thread swaps buffers once per tick
+ * and handles the whole batch, so there is no event per packet. Both buffers keep their capacity.
+ */
+class PacketInbox {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Packet>> back;
+
+    //Merges relative moves of one entity separated only by packets not touching entity positions
+    static void Coalesce(std::vector<std::shared_ptr<Packet>> &packets);
+
+public:
+    //Network thread
+    void Push(std::shared_ptr<Packet> packet);
+
+    //Game thread, batch is cleared and filled with packets received since the previous swap
+    void Swap(std::vector<std::shared_ptr<Packet>> &batch);
+};
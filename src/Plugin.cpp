@@ -13,6 +13,8 @@
 #include "Settings.hpp"
 #include "DebugInfo.hpp"
 #include "Chat.hpp"
+#include "ChatLog.hpp"
+#include "Render.hpp"
 
 
 struct Plugin {
@@ -144,6 +146,12 @@ namespace PluginApi {
 	void SendChatMessage(const std::string& msg) {
 		PUSH_EVENT("SendChatMessage", msg);
 	}
+
+	void AppendChat(const Chat& chat, int position) {
+		Render *render = GetRender();
+		if (render && render->GetChatLog())
+			render->GetChatLog()->Append(chat, position);
+	}
 }
 
 int LoadFileRequire(lua_State* L) {
@@ -314,6 +322,7 @@ void PluginSystem::Init() {
 	apiTable["GetBlockInfo"] = GetBlockInfo;
 	apiTable["GetDebugValue"] = PluginApi::GetDebugValue;
 	apiTable["SendChatMessage"] = PluginApi::SendChatMessage;
+	apiTable["AppendChat"] = PluginApi::AppendChat;
 }
 
 lua_State* PluginSystem::GetLuaState() {
@@ -1,7 +1,5 @@
 #include "Render.hpp"
 
-#include <random>
-
 #include <easylogging++.h>
 #include <optick.h>
 #include <RmlUi/Core.h>
@@ -20,6 +18,8 @@
 #include "Rml.hpp"
 #include "Gal.hpp"
 #include "RenderConfigs.hpp"
+#include "ChatLog.hpp"
+#include "HudData.hpp"
 
 const std::map<SDL_Keycode, Rml::Input::KeyIdentifier> keyMapping = {
     {SDLK_BACKSPACE, Rml::Input::KI_BACK},
@@ -76,12 +76,19 @@ Render::Render(unsigned int width, unsigned int height,
 }
 
 Render::~Render() {
+    chatLog.reset();
+    hudData.reset();
     Rml::RemoveContext("default");
     rmlRender.reset();
     rmlSystem.reset();
 
     PluginSystem::Init();
 
+    world.reset();
+    //Upload thread unbinds its context and is joined before the context is deleted
+    Gal::GetImplementation()->StopUploadThread();
+    if (uploadContext)
+        SDL_GL_DeleteContext(uploadContext);
     SDL_GL_DeleteContext(glContext);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -114,6 +121,12 @@ void Render::InitSdl(unsigned int WinWidth, unsigned int WinHeight, std::string
     if (!glContext)
         throw std::runtime_error("OpenGl context creation failed: " + std::string(SDL_GetError()));
 
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    uploadContext = SDL_GL_CreateContext(window);
+    if (!uploadContext)
+        LOG(WARNING) << "Upload context creation failed: " << SDL_GetError();
+    SDL_GL_MakeCurrent(window, glContext);
+
     SetMouseCapture(false);
 
     windowWidth = WinWidth;
@@ -144,79 +157,113 @@ void Render::PrepareToRendering() {
     gal->GetDefaultFramebuffer()->SetViewport(0, 0, width, height);
     gal->GetGlobalShaderParameters()->Get<GlobalShaderParameters>()->gamma = Settings::ReadDouble("gamma", 2.2);
 
+    renderGraph.reset();
     gbuffer.reset();
-    resizeTextureCopy.reset();
+    adaptiveQuality.reset();
     fbTextureCopy.reset();
     fbTextureColor.reset();
     fbTextureDepthStencil.reset();
     fbTarget.reset();
 
     bool useDeffered = Settings::ReadBool("deffered", false);
-    bool useResize = scaledW != width;
+    bool useDynamicResolution = Settings::ReadBool("dynamicResolution", false);
+    bool useResize = scaledW != width || useDynamicResolution;
+    std::shared_ptr<Gal::Shader> resizeShader = useDynamicResolution ? LoadPixelShader("/altcraft/shaders/frag/copy_scaled") : nullptr;
 
-    if (useDeffered) {
-        std::mt19937 rng(std::chrono::steady_clock::now().time_since_epoch().count());
-        std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
-        auto& ssaoKernels = gal->GetGlobalShaderParameters()->Get<GlobalShaderParameters>()->ssaoKernels;
-        for (auto& vec : ssaoKernels) {
-            vec.x = dis(rng);
-            vec.y = dis(rng);
-            vec.z = (dis(rng) + 1.0f) / 2.0f;
-            vec.w = 0.0f;
-            vec = glm::normalize(vec);
-        }
-        for (size_t i = 0; i < sizeof(ssaoKernels) / sizeof(*ssaoKernels); i++) {
-            float scale = i / 64.0f;
-            scale = glm::mix(0.1f, 1.0f, scale * scale);
-            ssaoKernels[i] *= scale;
-        }
+    int ssaoSamples = Settings::ReadDouble("ssaoSamples", 0);
+
+    renderGraph = std::make_unique<RenderGraph>();
+    auto backbuffer = renderGraph->ImportTarget();
+    RenderGraph::ResourceId sceneColor = backbuffer;
+    RenderGraph::ResourceId sceneDepthStencil = RenderGraph::invalidResource;
+    RenderGraph::PassId worldPass;
 
-        int ssaoSamples = Settings::ReadDouble("ssaoSamples", 0);
-        float ssaoScale = Settings::ReadDouble("ssaoScale", 0.5f);
+    if (useDeffered) {
+        float ssaoScale = _max(0.25f, _min(1.0f, static_cast<float>(Settings::ReadDouble("ssaoScale", 0.5f))));
         size_t ssaoW = scaledW * ssaoScale, ssaoH = scaledH * ssaoScale;
 
-        gbuffer = std::make_unique<Gbuffer>(scaledW, scaledH, scaledW, scaledH, ssaoSamples, ssaoW, ssaoH);
-        gbuffer->SetRenderBuff(renderBuff);
+        gbuffer = std::make_unique<Gbuffer>(*renderGraph, scaledW, scaledH, scaledW, scaledH, ssaoSamples, ssaoW, ssaoH);
         fbTarget = gbuffer->GetGeometryTarget();
-        if (useResize) {
-            auto fbTextureColorConf = gal->CreateTexture2DConfig(scaledW, scaledH, Gal::Format::R8G8B8);
-            fbTextureColorConf->SetMinFilter(Gal::Filtering::Bilinear);
-            fbTextureColorConf->SetMaxFilter(Gal::Filtering::Bilinear);
-            fbTextureColor = gal->BuildTexture(fbTextureColorConf);
-
-            resizeTextureCopy = std::make_unique<TextureFbCopy>(gbuffer->GetFinalTexture(), fbTextureColor);
-            fbTextureCopy = std::make_unique<TextureFbCopy>(fbTextureColor, gal->GetDefaultFramebuffer());
-        } else {
-            fbTextureCopy = std::make_unique<TextureFbCopy>(gbuffer->GetFinalTexture(), gal->GetDefaultFramebuffer());
-        }
+        worldPass = renderGraph->AddPass("World", {}, gbuffer->GetGeometryResources(), false);
+        //Lighting is at window resolution without resize, so it is written to the default framebuffer without a copy
+        if (useResize)
+            gbuffer->AddPasses(*renderGraph);
+        else
+            gbuffer->AddPasses(*renderGraph, backbuffer, gal->GetDefaultFramebuffer());
+        sceneColor = gbuffer->GetFinalResource();
+    } else if (useResize) {
+        sceneColor = renderGraph->CreateTexture(scaledW, scaledH, Gal::Format::R8G8B8, Gal::Filtering::Bilinear);
+        sceneDepthStencil = renderGraph->CreateTexture(scaledW, scaledH, Gal::Format::D24S8, Gal::Filtering::Bilinear);
+        worldPass = renderGraph->AddPass("World", {}, { sceneColor, sceneDepthStencil }, false);
     } else {
-        if (useResize) {
-            auto fbTextureColorConf = gal->CreateTexture2DConfig(scaledW, scaledH, Gal::Format::R8G8B8);
-            fbTextureColorConf->SetMinFilter(Gal::Filtering::Bilinear);
-            fbTextureColorConf->SetMaxFilter(Gal::Filtering::Bilinear);
-            fbTextureColor = gal->BuildTexture(fbTextureColorConf);
-
-            auto fbTextureDepthStencilConf = gal->CreateTexture2DConfig(scaledW, scaledH, Gal::Format::D24S8);
-            fbTextureDepthStencilConf->SetMinFilter(Gal::Filtering::Bilinear);
-            fbTextureDepthStencilConf->SetMaxFilter(Gal::Filtering::Bilinear);
-            fbTextureDepthStencil = gal->BuildTexture(fbTextureDepthStencilConf);
-
-            auto fbTargetConf = gal->CreateFramebufferConfig();
-            fbTargetConf->SetTexture(0, fbTextureColor);
-            fbTargetConf->SetDepthStencil(fbTextureDepthStencil);
-            fbTarget = gal->BuildFramebuffer(fbTargetConf);
-            fbTarget->SetViewport(0, 0, scaledW, scaledH);
-
-            fbTextureCopy = std::make_unique<TextureFbCopy>(fbTextureColor, gal->GetDefaultFramebuffer());
-        } else {
-            fbTarget = gal->GetDefaultFramebuffer();
-        }
+        fbTarget = gal->GetDefaultFramebuffer();
+        worldPass = renderGraph->AddPass("World", {}, { backbuffer }, false);
+    }
+
+    bool useCopy = sceneColor != backbuffer;
+    RenderGraph::PassId copyPass = useCopy ? renderGraph->AddPass("Copy", { sceneColor }, { backbuffer }, true) : 0;
+
+    auto guiPass = renderGraph->AddPass("Gui", {}, { backbuffer }, false);
+
+    renderGraph->Compile();
+
+    if (gbuffer) {
+        gbuffer->Build(*renderGraph);
+        gbuffer->SetRenderBuff(renderBuff);
+    } else if (useResize) {
+        fbTextureColor = renderGraph->GetTexture(sceneColor);
+        fbTextureDepthStencil = renderGraph->GetTexture(sceneDepthStencil);
+
+        auto fbTargetConf = gal->CreateFramebufferConfig();
+        fbTargetConf->SetTexture(0, fbTextureColor);
+        fbTargetConf->SetDepthStencil(fbTextureDepthStencil);
+        fbTarget = gal->BuildFramebuffer(fbTargetConf);
+        fbTarget->SetViewport(0, 0, scaledW, scaledH);
+    }
+
+    if (useCopy) {
+        fbTextureCopy = std::make_unique<TextureFbCopy>(renderGraph->GetTexture(sceneColor), gal->GetDefaultFramebuffer(), resizeShader);
+        renderGraph->SetPassFunction(copyPass, [this]() { fbTextureCopy->Copy(); });
+    }
+
+    renderGraph->SetPassTarget(worldPass, fbTarget);
+    renderGraph->SetPassFunction(worldPass, [this]() {
+        if (isWireframe)
+            Gal::GetImplementation()->SetWireframe(true);
+        if (renderWorld)
+            world->Render(static_cast<float>(windowWidth) / static_cast<float>(windowHeight));
+        if (isWireframe)
+            Gal::GetImplementation()->SetWireframe(false);
+    });
+
+    renderGraph->SetPassTarget(guiPass, gal->GetDefaultFramebuffer());
+    renderGraph->SetPassFunction(guiPass, [this]() { RenderGui(); });
+
+    gal->GetGlobalShaderParameters()->Get<GlobalShaderParameters>()->renderScale = glm::vec2(1.0f);
+    float targetFps = Settings::ReadDouble("targetFps", 60.0f);
+    if (Settings::ReadBool("vsync", false) || targetFps > 300.0f)
+        targetFps = 60.0f;
+    bool useAdaptiveSsao = gbuffer && ssaoSamples > 0 && Settings::ReadBool("ssaoAdaptive", false);
+    if (useDynamicResolution || useAdaptiveSsao) {
+        float minScale = useDynamicResolution ? Settings::ReadDouble("dynamicResolutionMin", 0.5f) : 1.0f;
+        int minSamples = useAdaptiveSsao ? _min(8, ssaoSamples) : ssaoSamples;
+        adaptiveQuality = std::make_unique<AdaptiveQuality>(targetFps, minScale, minSamples, ssaoSamples);
     }
 
     if (world)
         world->PrepareRender(fbTarget, useDeffered);
 }
 
+void Render::SetRenderScale(float scale) {
+    if (gbuffer) {
+        gbuffer->SetViewportScale(scale);
+    } else if (fbTextureColor) {
+        auto [width, height, depth] = fbTextureColor->GetSize();
+        fbTarget->SetViewport(0, 0, width * scale, height * scale);
+    }
+    Gal::GetImplementation()->GetGlobalShaderParameters()->Get<GlobalShaderParameters>()->renderScale = glm::vec2(scale);
+}
+
 void Render::UpdateKeyboard() {
     SDL_Scancode toUpdate[] = { SDL_SCANCODE_A,SDL_SCANCODE_W,SDL_SCANCODE_S,SDL_SCANCODE_D,SDL_SCANCODE_SPACE };
     const Uint8 *kbState = SDL_GetKeyboardState(0);
@@ -237,40 +284,32 @@ void Render::UpdateKeyboard() {
 
 void Render::RenderFrame() {
     OPTICK_EVENT();
+    auto frameStart = std::chrono::steady_clock::now();
 
-    Gal::GetImplementation()->GetDefaultFramebuffer()->Clear();
-    if (gbuffer)
-        gbuffer->Clear();
-    if (fbTarget)
-        fbTarget->Clear();
-    if (resizeTextureCopy)
-        resizeTextureCopy->Clear();
-    if (fbTextureCopy)
-        fbTextureCopy->Clear();
-
-    if (isWireframe)
-        Gal::GetImplementation()->SetWireframe(true);
-    if (renderWorld) {
-        world->Render(static_cast<float>(windowWidth) / static_cast<float>(windowHeight));
-    }
-    if (isWireframe)
-        Gal::GetImplementation()->SetWireframe(false);
+    auto gpuTimer = Gal::GetImplementation()->GetGpuTimer();
+    gpuTimer->BeginFrame();
+    renderGraph->Execute();
+    //Sections are meshed and uploaded on the loading screen too, while the world is not rendered
+    if (world)
+        world->EndFrame();
 
-    if (gbuffer)
-        gbuffer->Render();
-    if (resizeTextureCopy)
-        resizeTextureCopy->Copy();
-    if (fbTextureCopy)
-        fbTextureCopy->Copy();
+    double gpuFrameMs = 0.0;
+    for (const auto &result : gpuTimer->GetResults())
+        gpuFrameMs += result.second;
+    DebugInfo::gpuFrameTime = gpuFrameMs * 1000.0;
 
-    RenderGui();
-
-    if (world) {
-        world->Update(GetTime()->RemainTimeMs());
-    }
+    //Swap blocks on vsync, so the frame cost is CPU work before it or GPU time of the frame, whichever is longer
+    double cpuFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    double frameMs = _max(cpuFrameMs, gpuFrameMs);
 
     OPTICK_EVENT("VSYNC");
     SDL_GL_SwapWindow(window);
+
+    if (adaptiveQuality && adaptiveQuality->Update(frameMs)) {
+        SetRenderScale(adaptiveQuality->GetScale());
+        if (gbuffer)
+            gbuffer->SetSsaoSamples(adaptiveQuality->GetSamples());
+    }
 }
 
 void Render::HandleEvents() {
@@ -482,6 +521,7 @@ void Render::HandleEvents() {
     }
 
     rmlContext->Update();
+    chatLog->Update(rmlContext);
 
     if (clipboard != rmlSystem->clipboard) {
         clipboard = rmlSystem->clipboard;
@@ -511,13 +551,32 @@ void Render::SetMouseCapture(bool IsCaptured) {
 
 void Render::Update() {
 	OPTICK_EVENT();
+    PrepareFrame();
+    RenderFrame();
+}
+
+void Render::PollInput() {
+    OPTICK_EVENT();
     HandleEvents();
     if (HasFocus && GetState() == State::Playing) UpdateKeyboard();
     if (isMouseCaptured) HandleMouseCapture();
     glCheckError();
+    inputPolled = true;
+}
+
+void Render::PrepareFrame() {
+    OPTICK_EVENT();
+    hudData->Update(GetTime()->GetRealDeltaS());
+    if (!inputPolled)
+        PollInput();
+    inputPolled = false;
 
-    RenderFrame();
     listener.HandleAllEvents();
+
+    if (world && GetGameState() && GetGameState()->GetPlayer()) {
+        world->SetSnapshot(GetGameState()->CreateRenderSnapshot());
+        world->Update(GetTime()->RemainTimeMs());
+    }
 }
 
 void Render::RenderGui() {
@@ -534,8 +593,17 @@ void Render::InitEvents() {
 
     listener.RegisterHandler("PlayerConnected", [this](const Event&) {
         stateString = "Loading terrain...";
-        world = std::make_unique<RendererWorld>(fbTarget, Settings::ReadBool("deffered", false), Settings::ReadBool("smoothlight", false));
+        bool backgroundUploads = uploadContext && Settings::ReadBool("uploadThread", false);
+        if (backgroundUploads) {
+            Gal::GetImplementation()->StartUploadThread([this]() {
+                return SDL_GL_MakeCurrent(window, uploadContext) == 0;
+            }, [this]() {
+                SDL_GL_MakeCurrent(window, nullptr);
+            });
+        }
+        world = std::make_unique<RendererWorld>(fbTarget, Settings::ReadBool("deffered", false), Settings::ReadBool("smoothlight", false), backgroundUploads);
         world->MaxRenderingDistance = Settings::ReadDouble("renderDistance", 2.0f);
+        world->LodDistance = Settings::ReadDouble("lodDistance", 8.0f);
 		PUSH_EVENT("UpdateSectionsRender", 0);		
     });
 
@@ -558,6 +626,7 @@ void Render::InitEvents() {
         stateString = "Disconnected: " + eventData.get<std::string>();
         renderWorld = false;
         world.reset();
+        chatLog->Clear();
         SetState(State::MainMenu);
         PluginSystem::CallOnDisconnected("Disconnected: " + eventData.get<std::string>());
     });
@@ -608,8 +677,10 @@ void Render::InitEvents() {
         if (world) {
             world->smoothLighting = Settings::ReadBool("smoothlight", false);
             float renderDistance = Settings::ReadDouble("renderDistance", 2.0f);
-            if (renderDistance != world->MaxRenderingDistance) {
+            float lodDistance = Settings::ReadDouble("lodDistance", 8.0f);
+            if (renderDistance != world->MaxRenderingDistance || lodDistance != world->LodDistance) {
                 world->MaxRenderingDistance = renderDistance;
+                world->LodDistance = lodDistance;
                 PUSH_EVENT("UpdateSectionsRender", 0);
             }
         }
@@ -624,6 +695,10 @@ void Render::InitEvents() {
 
         isWireframe = Settings::ReadBool("wireframe", false);
 
+        Gal::GetImplementation()->GetGpuTimer()->SetEnabled(Settings::ReadBool("gpuTimers", false));
+
+        hudData->SetRefreshRate(Settings::ReadDouble("hudRefreshRate", 10.0));
+
         float targetFps = Settings::ReadDouble("targetFps", 60.0f);
         GetTime()->SetDelayLength(std::chrono::duration<double, std::milli>(1.0 / targetFps * 1000.0));
 
@@ -665,4 +740,12 @@ void Render::InitRml() {
 
     if (!Rml::Debugger::Initialise(rmlContext))
         LOG(WARNING) << "Rml debugger not initialized";
+
+    chatLog = std::make_unique<ChatLog>();
+    hudData = std::make_unique<HudData>(rmlContext);
+    hudData->SetRefreshRate(Settings::ReadDouble("hudRefreshRate", 10.0));
+}
+
+ChatLog *Render::GetChatLog() {
+    return chatLog.get();
 }
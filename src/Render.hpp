@@ -12,8 +12,12 @@
 #include "Gal.hpp"
 
 class Gbuffer;
+class RenderGraph;
 class TextureFbCopy;
+class AdaptiveQuality;
 class RendererWorld;
+class ChatLog;
+class HudData;
 class RmlRenderInterface;
 class RmlSystemInterface;
 class RmlFileInterface;
@@ -25,6 +29,8 @@ namespace Rml
 class Render {
     SDL_Window *window;
     SDL_GLContext glContext;
+    //Shares objects with glContext, current on the Gal upload thread. nullptr if not supported
+    SDL_GLContext uploadContext = nullptr;
 
     bool renderGui = false;
 	bool isMouseCaptured = false;
@@ -37,21 +43,25 @@ class Render {
     bool HasFocus=true;
     float sensetivity = 0.1f;
     bool isWireframe = false;
-    std::unique_ptr<TextureFbCopy> resizeTextureCopy;
     std::unique_ptr<TextureFbCopy> fbTextureCopy;
     std::shared_ptr<Gal::Texture> fbTextureColor;
     std::shared_ptr<Gal::Texture> fbTextureDepthStencil;
     std::shared_ptr<Gal::Framebuffer> fbTarget;
     std::unique_ptr<Gbuffer> gbuffer;
+    std::unique_ptr<RenderGraph> renderGraph;
+    std::unique_ptr<AdaptiveQuality> adaptiveQuality;
     EventListener listener;
     std::string stateString;
     std::unique_ptr<RmlRenderInterface> rmlRender;
     std::unique_ptr<RmlSystemInterface> rmlSystem;
     std::unique_ptr<RmlFileInterface> rmlFile;
     Rml::Context* rmlContext;
+    std::unique_ptr<ChatLog> chatLog;
+    std::unique_ptr<HudData> hudData;
     unsigned short sdlKeyMods = 0;
     bool hideRml = false;
     size_t renderBuff = 0;
+    bool inputPolled = false;
 
 	void SetMouseCapture(bool IsCaptured);
 
@@ -63,10 +73,10 @@ class Render {
 
 	void InitGlew();
 
-	void RenderFrame();
-
 	void PrepareToRendering();
 
+	void SetRenderScale(float scale);
+
     void UpdateKeyboard();
 
     void RenderGui();
@@ -80,4 +90,15 @@ public:
 	~Render();
 
 	void Update();
+
+	//Reads SDL input and pushes input events. Called by PrepareFrame unless already called this frame
+	void PollInput();
+
+	//Handles input and events and takes the game state snapshot, must not overlap GameState::Update
+	void PrepareFrame();
+
+	//Draws the prepared frame, reads no GameState, so it may run while the game is updated
+	void RenderFrame();
+
+	ChatLog *GetChatLog();
 };
@@ -4,6 +4,7 @@
 #include <random>
 
 #include "AssetManager.hpp"
+#include "Utility.hpp"
 
 std::string LoadShaderCode(std::string_view assetPath) {
     auto gal = Gal::GetImplementation();
@@ -116,24 +117,43 @@ PostProcess::PostProcess(
     std::shared_ptr<Gal::Shader> pixelShader,
     std::vector<std::pair<std::string_view, std::shared_ptr<Gal::Texture>>> inputTextures,
     std::vector<std::pair<std::string_view, Gal::Type>> inputParameters,
-    size_t width,
-    size_t height,
-    Gal::Format format,
-    Gal::Filtering filtering) {
+    std::shared_ptr<Gal::Texture> outputTexture,
+    std::vector<std::pair<std::string_view, std::shared_ptr<Gal::ShaderParametersBuffer>>> inputBuffers) {
     auto gal = Gal::GetImplementation();
 
-    auto texConf = gal->CreateTexture2DConfig(width, height, format);
-    texConf->SetMinFilter(filtering);
-    texConf->SetMaxFilter(filtering);
-
-    result = gal->BuildTexture(texConf);
-
     auto fbConf = gal->CreateFramebufferConfig();
-    fbConf->SetTexture(0, result);
+    fbConf->SetTexture(0, outputTexture);
+
+    auto [outputW, outputH, outputD] = outputTexture->GetSize();
+    width = outputW;
+    height = outputH;
 
     framebuffer = gal->BuildFramebuffer(fbConf);
     framebuffer->SetViewport(0, 0, width, height);
 
+    BuildPipeline(pixelShader, inputTextures, inputParameters, inputBuffers);
+}
+
+PostProcess::PostProcess(
+    std::shared_ptr<Gal::Shader> pixelShader,
+    std::vector<std::pair<std::string_view, std::shared_ptr<Gal::Texture>>> inputTextures,
+    std::vector<std::pair<std::string_view, Gal::Type>> inputParameters,
+    std::shared_ptr<Gal::Framebuffer> outputFb,
+    size_t width,
+    size_t height,
+    std::vector<std::pair<std::string_view, std::shared_ptr<Gal::ShaderParametersBuffer>>> inputBuffers) : width(width), height(height) {
+    framebuffer = std::move(outputFb);
+
+    BuildPipeline(pixelShader, inputTextures, inputParameters, inputBuffers);
+}
+
+void PostProcess::BuildPipeline(
+    std::shared_ptr<Gal::Shader> pixelShader,
+    const std::vector<std::pair<std::string_view, std::shared_ptr<Gal::Texture>>> &inputTextures,
+    const std::vector<std::pair<std::string_view, Gal::Type>> &inputParameters,
+    const std::vector<std::pair<std::string_view, std::shared_ptr<Gal::ShaderParametersBuffer>>> &inputBuffers) {
+    auto gal = Gal::GetImplementation();
+
     auto fbPPC = gal->CreatePipelineConfig();
     fbPPC->SetTarget(framebuffer);
     for (auto&& [name, texture] : inputTextures) {
@@ -142,6 +162,9 @@ PostProcess::PostProcess(
     for (auto&& [name, type] : inputParameters) {
         fbPPC->AddShaderParameter(name, type);
     }
+    for (auto&& [name, buffer] : inputBuffers) {
+        fbPPC->AddShaderParametersBuffer(name, buffer);
+    }
     fbPPC->SetVertexShader(LoadVertexShader("/altcraft/shaders/vert/quad"));
     fbPPC->SetPixelShader(pixelShader);
     auto fbBufferBB = fbPPC->BindVertexBuffer({
@@ -170,20 +193,22 @@ PostProcess::PostProcess(
         });
 }
 
-Gbuffer::Gbuffer(size_t geomW, size_t geomH, size_t lightW, size_t lightH, int ssaoSamples, size_t ssaoW, size_t ssaoH) {
+Gbuffer::Gbuffer(RenderGraph &graph, size_t geomW, size_t geomH, size_t lightW, size_t lightH, int ssaoSamples, size_t ssaoW, size_t ssaoH) :
+    lightW(lightW), lightH(lightH), ssaoW(ssaoW), ssaoH(ssaoH), ssaoSamples(ssaoSamples) {
     auto gal = Gal::GetImplementation();
 
-    auto colorConf = gal->CreateTexture2DConfig(geomW, geomH, Gal::Format::R8G8B8);
+    auto colorConf = gal->CreateTexture2DConfig(geomW, geomH, Gal::Format::R8G8B8A8);
     colorConf->SetMinFilter(Gal::Filtering::Bilinear);
     colorConf->SetMaxFilter(Gal::Filtering::Bilinear);
     color = gal->BuildTexture(colorConf);
 
-    auto normalConf = gal->CreateTexture2DConfig(geomW, geomH, Gal::Format::R8G8B8SN);
-    normalConf->SetMinFilter(Gal::Filtering::Bilinear);
-    normalConf->SetMaxFilter(Gal::Filtering::Bilinear);
+    //Octahedral encoding is not linear, interpolated texels would decode to wrong normals
+    auto normalConf = gal->CreateTexture2DConfig(geomW, geomH, Gal::Format::R8G8);
+    normalConf->SetMinFilter(Gal::Filtering::Nearest);
+    normalConf->SetMaxFilter(Gal::Filtering::Nearest);
     normal = gal->BuildTexture(normalConf);
 
-    auto lightConf = gal->CreateTexture2DConfig(geomW, geomH, Gal::Format::R8G8B8);
+    auto lightConf = gal->CreateTexture2DConfig(geomW, geomH, Gal::Format::R8G8);
     lightConf->SetMinFilter(Gal::Filtering::Bilinear);
     lightConf->SetMaxFilter(Gal::Filtering::Bilinear);
     light = gal->BuildTexture(lightConf);
@@ -202,6 +227,14 @@ Gbuffer::Gbuffer(size_t geomW, size_t geomH, size_t lightW, size_t lightH, int s
     geomFramebuffer = gal->BuildFramebuffer(geomFbConf);
     geomFramebuffer->SetViewport(0, 0, geomW, geomH);
 
+    depthStencilId = graph.ImportTexture(depthStencil);
+    colorId = graph.ImportTexture(color);
+    normalId = graph.ImportTexture(normal);
+    lightId = graph.ImportTexture(light);
+
+    //Low resolution ssao is upsampled with depth awareness, so occlusion does not leak over edges
+    ssaoUpsample = ssaoSamples > 0 && (ssaoW < geomW || ssaoH < geomH);
+
     if (ssaoSamples > 0) {
         auto noiseConf = gal->CreateTexture2DConfig(4, 4, Gal::Format::R8G8B8SN);
         noiseConf->SetWrapping(Gal::Wrapping::Repeat);
@@ -219,9 +252,48 @@ Gbuffer::Gbuffer(size_t geomW, size_t geomH, size_t lightW, size_t lightH, int s
         }
         ssaoNoise->SetData({ reinterpret_cast<std::byte*>(noiseTexData.data()), reinterpret_cast<std::byte*>(noiseTexData.data() + noiseTexData.size()) });
 
+        ssaoKernels = gal->CreateShaderParametersBuffer();
+        ssaoKernels->Resize<SsaoKernelsParameters>();
+        auto& kernels = ssaoKernels->Get<SsaoKernelsParameters>()->ssaoKernels;
+        constexpr size_t kernelsCount = sizeof(kernels) / sizeof(*kernels);
+        std::uniform_real_distribution<float> kernelDis(-1.0f, 1.0f);
+        for (size_t i = 0; i < kernelsCount; i++) {
+            glm::vec4 vec(kernelDis(rng), kernelDis(rng), (kernelDis(rng) + 1.0f) / 2.0f, 0.0f);
+            float scale = i / static_cast<float>(kernelsCount);
+            scale = glm::mix(0.1f, 1.0f, scale * scale);
+            kernels[i] = glm::normalize(vec) * scale;
+        }
+    }
+}
+
+void Gbuffer::AddPasses(RenderGraph &graph, RenderGraph::ResourceId output, std::shared_ptr<Gal::Framebuffer> outputFb) {
+    std::vector<RenderGraph::ResourceId> lightingInputs = { depthStencilId, colorId, normalId, lightId };
+
+    if (ssaoSamples > 0) {
+        ssaoId = graph.CreateTexture(ssaoW, ssaoH, Gal::Format::R8, Gal::Filtering::Bilinear);
+        ssaoBlurId = graph.CreateTexture(ssaoW, ssaoH, Gal::Format::R8, Gal::Filtering::Bilinear);
+
+        auto ssao = graph.AddPass("Ssao", { normalId, colorId, depthStencilId }, { ssaoId }, true);
+        graph.SetPassFunction(ssao, [this]() { ssaoPass->Render(); });
+
+        auto ssaoBlur = graph.AddPass("SsaoBlur", { ssaoId }, { ssaoBlurId }, true);
+        graph.SetPassFunction(ssaoBlur, [this]() { ssaoBlurPass->Render(); });
+
+        lightingInputs.push_back(ssaoBlurId);
+    }
+
+    finalFramebuffer = std::move(outputFb);
+    finalId = finalFramebuffer ? output : graph.CreateTexture(lightW, lightH, Gal::Format::R8G8B8, Gal::Filtering::Bilinear);
+
+    auto lighting = graph.AddPass("Lighting", lightingInputs, { finalId }, true);
+    graph.SetPassFunction(lighting, [this]() { lightingPass->Render(); });
+}
+
+void Gbuffer::Build(const RenderGraph &graph) {
+    if (ssaoSamples > 0) {
         std::vector<std::pair<std::string_view, std::shared_ptr<Gal::Texture>>> ssaoTextures = {
             {"normal", normal},
-            {"light", light},
+            {"color", color},
             {"depthStencil", depthStencil},
             {"ssaoNoise", ssaoNoise},
         };
@@ -230,18 +302,20 @@ Gbuffer::Gbuffer(size_t geomW, size_t geomH, size_t lightW, size_t lightH, int s
             {"ssaoSamples", Gal::Type::Int32},
         };
 
+        std::vector<std::pair<std::string_view, std::shared_ptr<Gal::ShaderParametersBuffer>>> ssaoBuffers = {
+            {"SsaoKernels", ssaoKernels},
+        };
+
         ssaoPass = std::make_unique<PostProcess>(LoadPixelShader("/altcraft/shaders/frag/ssao"),
             ssaoTextures,
             ssaoParameters,
-            ssaoW,
-            ssaoH,
-            Gal::Format::R8,
-            Gal::Filtering::Bilinear);
+            graph.GetTexture(ssaoId),
+            ssaoBuffers);
 
         ssaoPass->SetShaderParameter("ssaoSamples", ssaoSamples);
 
         std::vector<std::pair<std::string_view, std::shared_ptr<Gal::Texture>>> ssaoBlurTextures = {
-            {"blurInput", ssaoPass->GetResultTexture()},
+            {"blurInput", graph.GetTexture(ssaoId)},
         };
 
         std::vector<std::pair<std::string_view, Gal::Type>> ssaoBlurParameters = {
@@ -251,10 +325,7 @@ Gbuffer::Gbuffer(size_t geomW, size_t geomH, size_t lightW, size_t lightH, int s
         ssaoBlurPass = std::make_unique<PostProcess>(LoadPixelShader("/altcraft/shaders/frag/blur"),
             ssaoBlurTextures,
             ssaoBlurParameters,
-            ssaoW,
-            ssaoH,
-            Gal::Format::R8,
-            Gal::Filtering::Bilinear);
+            graph.GetTexture(ssaoBlurId));
 
         ssaoBlurPass->SetShaderParameter("blurScale", 2);
     }
@@ -262,6 +333,7 @@ Gbuffer::Gbuffer(size_t geomW, size_t geomH, size_t lightW, size_t lightH, int s
     std::vector<std::pair<std::string_view, Gal::Type>> lightingParameters = {
         {"renderBuff", Gal::Type::Int32},
         {"applySsao", Gal::Type::Int32},
+        {"ssaoUpsample", Gal::Type::Int32},
     };
 
     std::vector<std::pair<std::string_view, std::shared_ptr<Gal::Texture>>> lightingTextures = {
@@ -272,16 +344,72 @@ Gbuffer::Gbuffer(size_t geomW, size_t geomH, size_t lightW, size_t lightH, int s
     };
 
     if (ssaoSamples > 0)
-        lightingTextures.emplace_back("ssao", ssaoBlurPass->GetResultTexture());
+        lightingTextures.emplace_back("ssao", graph.GetTexture(ssaoBlurId));
 
-    lightingPass = std::make_unique<PostProcess>(LoadPixelShader("/altcraft/shaders/frag/light"),
-        lightingTextures,
-        lightingParameters,
-        lightW,
-        lightH,
-        Gal::Format::R8G8B8,
-        Gal::Filtering::Bilinear);
+    auto lightingShader = LoadPixelShader("/altcraft/shaders/frag/light");
+    if (finalFramebuffer)
+        lightingPass = std::make_unique<PostProcess>(lightingShader, lightingTextures, lightingParameters, finalFramebuffer, lightW, lightH);
+    else
+        lightingPass = std::make_unique<PostProcess>(lightingShader, lightingTextures, lightingParameters, graph.GetTexture(finalId));
 
     lightingPass->SetShaderParameter("applySsao", ssaoSamples);
+    lightingPass->SetShaderParameter("ssaoUpsample", ssaoUpsample ? 1 : 0);
+}
+
+
+void Gbuffer::SetViewportScale(float scale) {
+    auto [width, height, depth] = color->GetSize();
+    geomFramebuffer->SetViewport(0, 0, width * scale, height * scale);
+    if (ssaoPass) {
+        ssaoPass->SetViewportScale(scale);
+        ssaoBlurPass->SetViewportScale(scale);
+    }
+    lightingPass->SetViewportScale(scale);
+}
+
+FrameBudget::FrameBudget(double targetFps) {
+    targetFrameMs = 1000.0 / targetFps;
+    averageFrameMs = targetFrameMs;
 }
 
+int FrameBudget::Update(double frameMs) {
+    averageFrameMs += (frameMs - averageFrameMs) * averageFactor;
+
+    if (++framesSinceChange < changeCooldownFrames)
+        return 0;
+
+    if (averageFrameMs > targetFrameMs * upperBound)
+        return -1;
+    if (averageFrameMs < targetFrameMs * lowerBound)
+        return 1;
+    return 0;
+}
+
+AdaptiveQuality::AdaptiveQuality(double targetFps, float minScale, int minSamples, int maxSamples) : budget(targetFps), minScale(_min(1.0f, minScale)), samples(maxSamples), minSamples(_min(minSamples, maxSamples)), maxSamples(maxSamples) {
+
+}
+
+bool AdaptiveQuality::Update(double frameMs) {
+    int direction = budget.Update(frameMs);
+
+    if (direction < 0) {
+        if (samples > minSamples)
+            samples = _max(minSamples, samples - samplesStep * 2);
+        else if (scale > minScale)
+            scale = _max(minScale, scale - scaleStep * 2.0f);
+        else
+            return false;
+    } else if (direction > 0) {
+        if (scale < 1.0f)
+            scale = _min(1.0f, scale + scaleStep);
+        else if (samples < maxSamples)
+            samples = _min(maxSamples, samples + samplesStep);
+        else
+            return false;
+    } else {
+        return false;
+    }
+
+    budget.ResetCooldown();
+    return true;
+}
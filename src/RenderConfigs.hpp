@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Gal.hpp"
+#include "RenderGraph.hpp"
 
 struct GlobalShaderParameters {
     glm::mat4 projView;
@@ -8,17 +9,20 @@ struct GlobalShaderParameters {
     glm::mat4 invProj;
     glm::mat4 view;
     glm::uvec2 viewportSize;
-    glm::uint32 paddingFA = 0xFAAFFAFA;
-    glm::uint32 paddingFB = 0xFBFBFBFB;
-    glm::vec4 ssaoKernels[64];
     glm::float32 globalTime;
     glm::float32 dayTime;
     glm::float32 gamma;
     glm::uint32 paddingF0 = 0xF0F0F0F0;
+    glm::vec2 renderScale = glm::vec2(1.0f); //active part of the render targets, used by dynamic resolution
     glm::uint32 paddingF1 = 0xF1F1F1F1;
     glm::uint32 paddingF2 = 0xF2F2F2F2;
 };
 
+//Static SsaoKernels UBO, uploaded once per Gbuffer instead of every frame with Globals
+struct SsaoKernelsParameters {
+    glm::vec4 ssaoKernels[64];
+};
+
 std::shared_ptr<Gal::Shader> LoadVertexShader(std::string_view assetPath);
 
 std::shared_ptr<Gal::Shader> LoadPixelShader(std::string_view assetPath);
@@ -51,26 +55,37 @@ public:
     }
 };
 
+//Full-screen pass, renders into a texture provided by RenderGraph or into an external framebuffer
 class PostProcess {
     std::shared_ptr<Gal::Framebuffer> framebuffer;
     std::shared_ptr<Gal::Buffer> fbBuffer;
     std::shared_ptr<Gal::Pipeline> pipeline;
     std::shared_ptr<Gal::PipelineInstance> pipelineInstance;
-    std::shared_ptr<Gal::Texture> result;
+    size_t width, height;
+
+    void BuildPipeline(
+        std::shared_ptr<Gal::Shader> pixelShader,
+        const std::vector<std::pair<std::string_view, std::shared_ptr<Gal::Texture>>> &inputTextures,
+        const std::vector<std::pair<std::string_view, Gal::Type>> &inputParameters,
+        const std::vector<std::pair<std::string_view, std::shared_ptr<Gal::ShaderParametersBuffer>>> &inputBuffers);
+
 public:
 
     PostProcess(
         std::shared_ptr<Gal::Shader> pixelShader,
         std::vector<std::pair<std::string_view, std::shared_ptr<Gal::Texture>>> inputTextures,
         std::vector<std::pair<std::string_view, Gal::Type>> inputParameters,
+        std::shared_ptr<Gal::Texture> outputTexture,
+        std::vector<std::pair<std::string_view, std::shared_ptr<Gal::ShaderParametersBuffer>>> inputBuffers = {});
+
+    PostProcess(
+        std::shared_ptr<Gal::Shader> pixelShader,
+        std::vector<std::pair<std::string_view, std::shared_ptr<Gal::Texture>>> inputTextures,
+        std::vector<std::pair<std::string_view, Gal::Type>> inputParameters,
+        std::shared_ptr<Gal::Framebuffer> outputFb,
         size_t width,
         size_t height,
-        Gal::Format format,
-        Gal::Filtering filtering);
-
-    void Clear() {
-        framebuffer->Clear();
-    }
+        std::vector<std::pair<std::string_view, std::shared_ptr<Gal::ShaderParametersBuffer>>> inputBuffers = {});
 
     void Render() {
         pipeline->Activate();
@@ -83,48 +98,57 @@ public:
         pipeline->SetShaderParameter(name, value);
     }
 
-    std::shared_ptr<Gal::Texture> GetResultTexture() {
-        return result;
+    void SetViewportScale(float scale) {
+        framebuffer->SetViewport(0, 0, width * scale, height * scale);
     }
 };
 
+/*
+ * Deferred shading targets and passes.
+ * Geometry attachments are owned by the Gbuffer and imported into the RenderGraph,
+ * ssao, its blur and the lighting result are transient graph textures.
+ * Passes are declared by AddPasses, pipelines are built by Build after the graph is compiled.
+ */
 class Gbuffer {
     std::shared_ptr<Gal::Texture> ssaoNoise;
+    std::shared_ptr<Gal::ShaderParametersBuffer> ssaoKernels;
     std::unique_ptr<PostProcess> ssaoPass;
     std::unique_ptr<PostProcess> ssaoBlurPass;
     std::unique_ptr<PostProcess> lightingPass;
     std::shared_ptr<Gal::Texture> depthStencil;
-    std::shared_ptr<Gal::Texture> color; //RGB - color
-    std::shared_ptr<Gal::Texture> normal; //RGB - normal
-    std::shared_ptr<Gal::Texture> light; //R - faceLight, G - skyLight, B - ssaoDepthMask
+    std::shared_ptr<Gal::Texture> color; //RGB - color, A - ssaoDepthMask
+    std::shared_ptr<Gal::Texture> normal; //RG - octahedral view space normal
+    std::shared_ptr<Gal::Texture> light; //R - faceLight, G - skyLight
     std::shared_ptr<Gal::Framebuffer> geomFramebuffer;
+    std::shared_ptr<Gal::Framebuffer> finalFramebuffer;
+
+    size_t lightW, lightH, ssaoW, ssaoH;
+    int ssaoSamples;
+    bool ssaoUpsample;
+
+    RenderGraph::ResourceId depthStencilId, colorId, normalId, lightId;
+    RenderGraph::ResourceId ssaoId = RenderGraph::invalidResource;
+    RenderGraph::ResourceId ssaoBlurId = RenderGraph::invalidResource;
+    RenderGraph::ResourceId finalId = RenderGraph::invalidResource;
 
 public:
-    Gbuffer(size_t geomW, size_t geomH, size_t lightW, size_t lightH, int ssaoSamples, size_t ssaoW, size_t ssaoH);
+    Gbuffer(RenderGraph &graph, size_t geomW, size_t geomH, size_t lightW, size_t lightH, int ssaoSamples, size_t ssaoW, size_t ssaoH);
 
     std::shared_ptr<Gal::Framebuffer> GetGeometryTarget() {
         return geomFramebuffer;
     }
 
-    std::shared_ptr<Gal::Texture> GetFinalTexture() {
-        return lightingPass->GetResultTexture();
+    std::vector<RenderGraph::ResourceId> GetGeometryResources() const {
+        return { depthStencilId, colorId, normalId, lightId };
     }
 
-    void Render() {
-        if (ssaoPass) {
-            ssaoPass->Render();
-            ssaoBlurPass->Render();
-        }
-        lightingPass->Render();
-    }
+    //Lighting renders into outputFb if it is set, into a transient texture otherwise
+    void AddPasses(RenderGraph &graph, RenderGraph::ResourceId output = RenderGraph::invalidResource, std::shared_ptr<Gal::Framebuffer> outputFb = nullptr);
 
-    void Clear() {
-        geomFramebuffer->Clear();
-        if (ssaoPass) {
-            ssaoPass->Clear();
-            ssaoBlurPass->Clear();
-        }
-        lightingPass->Clear();
+    void Build(const RenderGraph &graph);
+
+    RenderGraph::ResourceId GetFinalResource() const {
+        return finalId;
     }
 
     int GetMaxRenderBuffers() {
@@ -134,4 +158,70 @@ public:
     void SetRenderBuff(int renderBuff) {
         lightingPass->SetShaderParameter("renderBuff", renderBuff);
     }
+
+    void SetSsaoSamples(int ssaoSamples) {
+        if (ssaoPass)
+            ssaoPass->SetShaderParameter("ssaoSamples", ssaoSamples);
+    }
+
+    //Renders into the top-left part of all targets, shaders read it through Globals.renderScale
+    void SetViewportScale(float scale);
+};
+
+/*
+ * Tracks averaged frame time against the frame budget.
+ * Reports a change only after the average stays out of the
+ * [lowerBound, upperBound] band of the budget for a while, so users do not oscillate.
+ */
+class FrameBudget {
+    double targetFrameMs;
+    double averageFrameMs;
+    size_t framesSinceChange = 0;
+
+    static constexpr double averageFactor = 0.1;
+    static constexpr double upperBound = 1.05;
+    static constexpr double lowerBound = 0.8;
+    static constexpr size_t changeCooldownFrames = 30;
+
+public:
+    FrameBudget(double targetFps);
+
+    //Returns -1 if frames are over the budget, 1 if there is headroom, 0 otherwise
+    int Update(double frameMs);
+
+    void ResetCooldown() {
+        framesSinceChange = 0;
+    }
+};
+
+/*
+ * Holds frame time near the target with a single budget for all quality settings.
+ * Over the budget ssao samples are lowered first and render scale after them,
+ * with headroom render scale is restored first, so settings never react to the same frames together.
+ */
+class AdaptiveQuality {
+    FrameBudget budget;
+    float scale = 1.0f;
+    float minScale;
+    int samples;
+    int minSamples;
+    int maxSamples;
+
+    static constexpr float scaleStep = 0.05f;
+    static constexpr int samplesStep = 4;
+
+public:
+    //minScale 1 keeps resolution fixed, minSamples equal to maxSamples keeps ssao fixed
+    AdaptiveQuality(double targetFps, float minScale, int minSamples, int maxSamples);
+
+    //Returns true if scale or sample count is changed
+    bool Update(double frameMs);
+
+    float GetScale() const {
+        return scale;
+    }
+
+    int GetSamples() const {
+        return samples;
+    }
 };
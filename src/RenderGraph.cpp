@@ -0,0 +1,115 @@
+#include "RenderGraph.hpp"
+
+#include <algorithm>
+
+#include <easylogging++.h>
+#include <optick.h>
+
+RenderGraph::ResourceId RenderGraph::ImportTexture(std::shared_ptr<Gal::Texture> texture) {
+    Resource resource{};
+    resource.isTransient = false;
+    resource.texture = std::move(texture);
+    resources.push_back(std::move(resource));
+    return resources.size() - 1;
+}
+
+RenderGraph::ResourceId RenderGraph::ImportTarget() {
+    return ImportTexture(nullptr);
+}
+
+RenderGraph::ResourceId RenderGraph::CreateTexture(size_t width, size_t height, Gal::Format format, Gal::Filtering filtering) {
+    Resource resource{};
+    resource.isTransient = true;
+    resource.desc = TextureDesc{ width, height, format, filtering };
+    resources.push_back(std::move(resource));
+    return resources.size() - 1;
+}
+
+RenderGraph::PassId RenderGraph::AddPass(std::string_view name, std::vector<ResourceId> inputs, std::vector<ResourceId> outputs, bool isFullscreen) {
+    Pass pass;
+    pass.name = std::string(name);
+    pass.inputs = std::move(inputs);
+    pass.outputs = std::move(outputs);
+    pass.isFullscreen = isFullscreen;
+    passes.push_back(std::move(pass));
+    return passes.size() - 1;
+}
+
+void RenderGraph::SetPassTarget(PassId pass, std::shared_ptr<Gal::Framebuffer> target) {
+    passes[pass].target = std::move(target);
+}
+
+void RenderGraph::SetPassFunction(PassId pass, std::function<void()> function) {
+    passes[pass].function = std::move(function);
+}
+
+void RenderGraph::Compile() {
+    for (size_t i = 0; i < passes.size(); i++) {
+        for (ResourceId id : passes[i].inputs) {
+            resources[id].firstUse = std::min(resources[id].firstUse, i);
+            resources[id].lastUse = std::max(resources[id].lastUse, i);
+        }
+        for (ResourceId id : passes[i].outputs) {
+            //Written before read in this frame, so contents of previous frames are never needed
+            passes[i].needsClear |= !passes[i].isFullscreen && resources[id].firstUse > i;
+            resources[id].firstUse = std::min(resources[id].firstUse, i);
+            resources[id].lastUse = std::max(resources[id].lastUse, i);
+        }
+    }
+
+    std::vector<ResourceId> transient;
+    for (ResourceId id = 0; id < resources.size(); id++) {
+        if (resources[id].isTransient && resources[id].firstUse != static_cast<size_t>(-1))
+            transient.push_back(id);
+    }
+    std::sort(transient.begin(), transient.end(), [this](ResourceId lhs, ResourceId rhs) {
+        return resources[lhs].firstUse < resources[rhs].firstUse;
+    });
+
+    struct PhysicalTexture {
+        TextureDesc desc;
+        std::shared_ptr<Gal::Texture> texture;
+        size_t lastUse;
+    };
+    std::vector<PhysicalTexture> physical;
+
+    auto gal = Gal::GetImplementation();
+    for (ResourceId id : transient) {
+        Resource &resource = resources[id];
+        auto it = std::find_if(physical.begin(), physical.end(), [&resource](const PhysicalTexture &texture) {
+            return texture.desc == resource.desc && texture.lastUse < resource.firstUse;
+        });
+        if (it == physical.end()) {
+            auto conf = gal->CreateTexture2DConfig(resource.desc.width, resource.desc.height, resource.desc.format);
+            conf->SetMinFilter(resource.desc.filtering);
+            conf->SetMaxFilter(resource.desc.filtering);
+            physical.push_back(PhysicalTexture{ resource.desc, gal->BuildTexture(conf), resource.lastUse });
+            it = physical.end() - 1;
+        }
+        it->lastUse = resource.lastUse;
+        resource.texture = it->texture;
+    }
+
+    size_t clears = std::count_if(passes.begin(), passes.end(), [](const Pass &pass) { return pass.needsClear; });
+    LOG(INFO) << "Render graph compiled: " << passes.size() << " passes, " << clears << " clears, "
+        << physical.size() << " textures for " << transient.size() << " transient resources";
+    isCompiled = true;
+}
+
+void RenderGraph::Execute() {
+    OPTICK_EVENT();
+    if (!isCompiled)
+        return;
+
+    auto gpuTimer = Gal::GetImplementation()->GetGpuTimer();
+    for (auto &pass : passes) {
+        if (pass.needsClear && pass.target) {
+            gpuTimer->BeginScope("Clear");
+            pass.target->Clear();
+        }
+        gpuTimer->BeginScope(pass.name);
+        if (pass.function)
+            pass.function();
+    }
+    gpuTimer->EndScope();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Gal.hpp"
+
+/*
+ * Passes of a frame with the resources they read and write.
+ * Passes are executed in declaration order. Compile derives from the declarations
+ * which targets need a clear: only rasterizing passes writing a resource first in a frame,
+ * full-screen passes overwrite their outputs. Transient textures are allocated by the graph,
+ * resources with equal descriptions and non-overlapping lifetimes share one texture.
+ */
+class RenderGraph {
+public:
+    using ResourceId = size_t;
+    using PassId = size_t;
+
+    static constexpr ResourceId invalidResource = static_cast<ResourceId>(-1);
+
+private:
+    struct TextureDesc {
+        size_t width;
+        size_t height;
+        Gal::Format format;
+        Gal::Filtering filtering;
+
+        bool operator==(const TextureDesc &rhs) const {
+            return width == rhs.width && height == rhs.height && format == rhs.format && filtering == rhs.filtering;
+        }
+    };
+
+    struct Resource {
+        bool isTransient;
+        TextureDesc desc;
+        std::shared_ptr<Gal::Texture> texture;
+        size_t firstUse = static_cast<size_t>(-1);
+        size_t lastUse = 0;
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<ResourceId> inputs;
+        std::vector<ResourceId> outputs;
+        bool isFullscreen;
+        std::shared_ptr<Gal::Framebuffer> target;
+        std::function<void()> function;
+        bool needsClear = false;
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    bool isCompiled = false;
+
+public:
+    //Texture owned outside of the graph, e.g. G-buffer attachments
+    ResourceId ImportTexture(std::shared_ptr<Gal::Texture> texture);
+
+    //Default framebuffer or any other target not sampled by passes
+    ResourceId ImportTarget();
+
+    //Texture allocated by Compile, may be shared with other transient textures
+    ResourceId CreateTexture(size_t width, size_t height, Gal::Format format, Gal::Filtering filtering);
+
+    //Full-screen passes overwrite every output texel, so their outputs are never cleared
+    PassId AddPass(std::string_view name, std::vector<ResourceId> inputs, std::vector<ResourceId> outputs, bool isFullscreen);
+
+    void SetPassTarget(PassId pass, std::shared_ptr<Gal::Framebuffer> target);
+
+    void SetPassFunction(PassId pass, std::function<void()> function);
+
+    void Compile();
+
+    std::shared_ptr<Gal::Texture> GetTexture(ResourceId resource) const {
+        return resources[resource].texture;
+    }
+
+    void Execute();
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <glm/mat4x4.hpp>
+
+#include "Vector.hpp"
+
+/*
+ * Immutable copy of the game state the world renderer needs for one frame.
+ * Taken by GameState::CreateRenderSnapshot before the game update, so the frame
+ * can be drawn while the next game update is running.
+ */
+struct RenderSnapshot {
+    struct EntityTransform {
+        unsigned int entityId = 0;
+        VectorF pos;
+        double width = 0;
+        double height = 0;
+        glm::vec3 color = glm::vec3(0);
+    };
+
+    glm::mat4 view = glm::mat4(1.0f);
+    VectorF playerPos;
+    Vector selectedBlock;
+    VectorF raycastHit;
+    double interpolatedTimeOfDay = 0;
+    std::vector<EntityTransform> entities; //sorted by entityId
+
+    const EntityTransform *GetEntity(unsigned int entityId) const {
+        auto it = std::lower_bound(entities.begin(), entities.end(), entityId, [](const EntityTransform &entity, unsigned int id) {
+            return entity.entityId < id;
+        });
+        return it != entities.end() && it->entityId == entityId ? &*it : nullptr;
+    }
+};
@@ -1,13 +1,16 @@
 #pragma once
 
 #include "Gal.hpp"
-
-class World;
+#include "RenderSnapshot.hpp"
 
 class RendererEntity {
     unsigned int entityId;
 public:
     RendererEntity(unsigned int id);
 
-    void Render(std::shared_ptr<Gal::Pipeline> pipeline, const World *world);
+    void Render(std::shared_ptr<Gal::Pipeline> pipeline, const RenderSnapshot::EntityTransform &entity);
+
+    unsigned int GetEntityId() const {
+        return entityId;
+    }
 };
@@ -1,6 +1,7 @@
 #include "RendererSection.hpp"
 
 #include <cstddef>
+#include <cstring>
 
 #include <easylogging++.h>
 #include <optick.h>
@@ -13,24 +14,82 @@ RendererSection::RendererSection(const RendererSectionData& data,
 	std::shared_ptr<Gal::Pipeline> solidPipeline,
 	std::shared_ptr<Gal::BufferBinding> solidBufferBinding,
 	std::shared_ptr<Gal::Pipeline> liquidPipeline,
-	std::shared_ptr<Gal::BufferBinding> liquidBufferBinding) {
+	std::shared_ptr<Gal::BufferBinding> liquidBufferBinding,
+	Gal::UploadRing *ring,
+	const Gal::UploadAllocation *upload) {
 	OPTICK_EVENT();
 
 	auto gal = Gal::GetImplementation();
+	solidBuffer = gal->CreateBuffer();
+	liquidBuffer = gal->CreateBuffer();
+	CreateInstances(solidPipeline, solidBufferBinding, liquidPipeline, liquidBufferBinding);
+
+	if (ring && upload)
+		UpdateData(data, *ring, *upload);
+	else
+		UpdateData(data);
+}
+
+RendererSection::RendererSection(const RendererSectionData &data,
+	std::shared_ptr<Gal::Pipeline> solidPipeline,
+	std::shared_ptr<Gal::BufferBinding> solidBufferBinding,
+	std::shared_ptr<Gal::Pipeline> liquidPipeline,
+	std::shared_ptr<Gal::BufferBinding> liquidBufferBinding,
+	std::shared_ptr<Gal::Buffer> solidVertexBuffer,
+	std::shared_ptr<Gal::Buffer> liquidVertexBuffer) {
+	OPTICK_EVENT();
+
+	solidBuffer = std::move(solidVertexBuffer);
+	liquidBuffer = std::move(liquidVertexBuffer);
+	CreateInstances(solidPipeline, solidBufferBinding, liquidPipeline, liquidBufferBinding);
+
+	solidFacesCount = data.solidVertices.size();
+	liquidFacesCount = data.liquidVertices.size();
+	sectionPos = data.sectionPos;
+	hash = data.hash;
+	lod = data.lod;
+}
 
+RendererSection::RendererSection(const Vector &sectionPos,
+	const std::vector<const RendererSection*> &members,
+	std::shared_ptr<Gal::Pipeline> solidPipeline,
+	std::shared_ptr<Gal::BufferBinding> solidBufferBinding,
+	std::shared_ptr<Gal::Pipeline> liquidPipeline,
+	std::shared_ptr<Gal::BufferBinding> liquidBufferBinding) {
+	OPTICK_EVENT();
+
+	std::vector<std::pair<std::shared_ptr<Gal::Buffer>, size_t>> solidSources, liquidSources;
+	for (const RendererSection *member : members) {
+		solidSources.emplace_back(member->solidBuffer, member->solidFacesCount * sizeof(VertexData));
+		liquidSources.emplace_back(member->liquidBuffer, member->liquidFacesCount * sizeof(VertexData));
+		solidFacesCount += member->solidFacesCount;
+		liquidFacesCount += member->liquidFacesCount;
+	}
+
+	auto gal = Gal::GetImplementation();
 	solidBuffer = gal->CreateBuffer();
+	liquidBuffer = gal->CreateBuffer();
+	solidBuffer->CopyData(solidSources);
+	liquidBuffer->CopyData(liquidSources);
+	CreateInstances(solidPipeline, solidBufferBinding, liquidPipeline, liquidBufferBinding);
+
+	this->sectionPos = sectionPos;
+}
+
+void RendererSection::CreateInstances(
+	std::shared_ptr<Gal::Pipeline> solidPipeline,
+	std::shared_ptr<Gal::BufferBinding> solidBufferBinding,
+	std::shared_ptr<Gal::Pipeline> liquidPipeline,
+	std::shared_ptr<Gal::BufferBinding> liquidBufferBinding) {
 	solidPipelineInstance = solidPipeline->CreateInstance({
 		{solidBufferBinding, solidBuffer}
 		});
 	solidPipelineInstance->SetInstancesCount(4);
 
-	liquidBuffer = gal->CreateBuffer();
 	liquidPipelineInstance = liquidPipeline->CreateInstance({
 		{liquidBufferBinding, liquidBuffer}
 		});
 	liquidPipelineInstance->SetInstancesCount(4);
-	
-	UpdateData(data);
 }
 
 RendererSection::RendererSection(RendererSection && other) {
@@ -56,6 +115,7 @@ void swap(RendererSection & lhs, RendererSection & rhs) {
 	std::swap(lhs.liquidPipelineInstance, rhs.liquidPipelineInstance);
 	std::swap(lhs.liquidBuffer, rhs.liquidBuffer);
     std::swap(lhs.hash, rhs.hash);
+    std::swap(lhs.lod, rhs.lod);
     std::swap(lhs.solidFacesCount, rhs.solidFacesCount);
     std::swap(lhs.liquidFacesCount, rhs.liquidFacesCount);
     std::swap(lhs.sectionPos, rhs.sectionPos);
@@ -80,4 +140,39 @@ void RendererSection::UpdateData(const RendererSectionData & data) {
 
 	sectionPos = data.sectionPos;
 	hash = data.hash;
+	lod = data.lod;
+}
+
+void RendererSection::UpdateData(const RendererSectionData &data, Gal::UploadRing &ring, const Gal::UploadAllocation &upload) {
+	OPTICK_EVENT();
+
+	size_t solidSize = data.solidVertices.size() * sizeof(VertexData);
+	size_t liquidSize = data.liquidVertices.size() * sizeof(VertexData);
+
+	solidBuffer->SetData(ring, Gal::UploadAllocation{ upload.data, upload.offset, solidSize });
+	solidFacesCount = data.solidVertices.size();
+
+	liquidBuffer->SetData(ring, Gal::UploadAllocation{ upload.data + solidSize, upload.offset + solidSize, liquidSize });
+	liquidFacesCount = data.liquidVertices.size();
+
+	sectionPos = data.sectionPos;
+	hash = data.hash;
+	lod = data.lod;
+}
+
+Gal::UploadAllocation RendererSection::Stage(const RendererSectionData &data, Gal::UploadRing &ring) {
+	OPTICK_EVENT();
+
+	size_t solidSize = data.solidVertices.size() * sizeof(VertexData);
+	size_t liquidSize = data.liquidVertices.size() * sizeof(VertexData);
+
+	Gal::UploadAllocation upload = ring.Allocate(solidSize + liquidSize);
+	if (!upload.data)
+		return upload;
+
+	if (solidSize)
+		std::memcpy(upload.data, data.solidVertices.data(), solidSize);
+	if (liquidSize)
+		std::memcpy(upload.data + solidSize, data.liquidVertices.data(), liquidSize);
+	return upload;
 }
@@ -13,16 +13,44 @@ class RendererSection {
     std::shared_ptr<Gal::Buffer> liquidBuffer;
     Vector sectionPos;
 	size_t hash = 0;
+    int lod = 0;
     size_t solidFacesCount = 0;
     size_t liquidFacesCount = 0;
 
     RendererSection(const RendererSection &other) = delete;
+
+    void CreateInstances(
+        std::shared_ptr<Gal::Pipeline> solidPipeline,
+        std::shared_ptr<Gal::BufferBinding> solidBufferBinding,
+        std::shared_ptr<Gal::Pipeline> liquidPipeline,
+        std::shared_ptr<Gal::BufferBinding> liquidBufferBinding);
 public:
     RendererSection(
         const RendererSectionData& data,
         std::shared_ptr<Gal::Pipeline> solidPipeline,
         std::shared_ptr<Gal::BufferBinding> solidBufferBinding,
         std::shared_ptr<Gal::Pipeline> liquidPipeline,
+        std::shared_ptr<Gal::BufferBinding> liquidBufferBinding,
+        Gal::UploadRing *ring = nullptr,
+        const Gal::UploadAllocation *upload = nullptr);
+
+    //Takes buffers already filled with data vertices, e.g. by the upload thread
+    RendererSection(
+        const RendererSectionData &data,
+        std::shared_ptr<Gal::Pipeline> solidPipeline,
+        std::shared_ptr<Gal::BufferBinding> solidBufferBinding,
+        std::shared_ptr<Gal::Pipeline> liquidPipeline,
+        std::shared_ptr<Gal::BufferBinding> liquidBufferBinding,
+        std::shared_ptr<Gal::Buffer> solidVertexBuffer,
+        std::shared_ptr<Gal::Buffer> liquidVertexBuffer);
+
+    //Vertices of members are concatenated on GPU, e.g. into a region batch
+    RendererSection(
+        const Vector &sectionPos,
+        const std::vector<const RendererSection*> &members,
+        std::shared_ptr<Gal::Pipeline> solidPipeline,
+        std::shared_ptr<Gal::BufferBinding> solidBufferBinding,
+        std::shared_ptr<Gal::Pipeline> liquidPipeline,
         std::shared_ptr<Gal::BufferBinding> liquidBufferBinding);
 
     RendererSection(RendererSection &&other);
@@ -35,6 +63,8 @@ public:
 
     size_t GetHash();
 
+    inline int GetLod() { return lod; }
+
     inline size_t GetSolidFacesCount() { return solidFacesCount; }
 
     inline size_t GetLiquidFacesCount() { return liquidFacesCount; }
@@ -42,4 +72,10 @@ public:
     friend void swap(RendererSection &lhs, RendererSection &rhs);
 
 	void UpdateData(const RendererSectionData &data);
+
+    //Vertices are copied on GPU from the allocation written by Stage
+    void UpdateData(const RendererSectionData &data, Gal::UploadRing &ring, const Gal::UploadAllocation &upload);
+
+    //Writes solid and then liquid vertices into one allocation, callable from any thread
+    static Gal::UploadAllocation Stage(const RendererSectionData &data, Gal::UploadRing &ring);
 };
\ No newline at end of file
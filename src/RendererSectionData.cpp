@@ -6,6 +6,7 @@
 #include <glm/gtc/matrix_inverse.hpp>
 #include <optick.h>
 
+#include "DebugInfo.hpp"
 #include "World.hpp"
 
 inline const BlockId& GetBlockId(const Vector& pos, const std::array<BlockId, 4096> &blockIdData) {
@@ -59,19 +60,56 @@ float InterpolateBlockLightness(const BlockLightness& light, const glm::vec3 &po
     return (glm::max)(xLight, (glm::max)(yLight, zLight));
 }
 
-void AddFacesByBlockModel(RendererSectionData& data, const BlockFaces& model, const glm::mat4& transform, bool visibility[FaceDirection::none], const Vector &pos, const SectionsData &sections, bool smoothLighting) {
+//Full blocks of the section and its one block border
+using OccluderData = std::array<bool, 18 * 18 * 18>;
+
+inline bool IsOccluder(const OccluderData &occluders, const Vector &pos) {
+	return occluders[((pos.y + 1) * 18 + (pos.z + 1)) * 18 + (pos.x + 1)];
+}
+
+constexpr float cornerAoLevels[] = { 0.5f, 0.7f, 0.85f, 1.0f };
+
+//Classic voxel corner occlusion by two side blocks and the diagonal block in front of the face
+float GetCornerAo(const OccluderData &occluders, const Vector &front, const Vector &side1, const Vector &side2) {
+	bool s1 = IsOccluder(occluders, front + side1);
+	bool s2 = IsOccluder(occluders, front + side2);
+	bool corner = IsOccluder(occluders, front + side1 + side2);
+	int level = s1 && s2 ? 0 : 3 - (s1 + s2 + corner);
+	return cornerAoLevels[level];
+}
+
+//Section direction the cullable face of the rotated model is facing, none if the face is not cullable
+FaceDirection GetFaceDirection(const BlockFaces &model, const ParsedFace &face) {
+	if (face.visibility == FaceDirection::none)
+		return FaceDirection::none;
+	Vector directionVec = model.faceDirectionVector[face.visibility];
+	for (int i = 0; i < FaceDirection::none; i++) {
+		if (FaceDirectionVector[i] == directionVec)
+			return FaceDirection(i);
+	}
+	return FaceDirection::none;
+}
+
+//Same culling as AddFacesByBlockModel, used to size the output before meshing
+size_t CountFacesByBlockModel(const BlockFaces &model, const bool visibility[FaceDirection::none]) {
+	size_t count = 0;
+	for (const auto &face : model.faces) {
+		if (face.visibility == FaceDirection::none) {
+			count++;
+			continue;
+		}
+		FaceDirection faceDirection = GetFaceDirection(model, face);
+		if (faceDirection != FaceDirection::none && !visibility[faceDirection])
+			count++;
+	}
+	return count;
+}
+
+void AddFacesByBlockModel(RendererSectionData& data, const BlockFaces& model, const glm::mat4& transform, bool visibility[FaceDirection::none], const Vector &pos, const SectionsData &sections, bool smoothLighting, const OccluderData *occluders = nullptr) {
     glm::vec3 absPos = (sections.data[1][1][1].GetPosition() * 16).glm();
     for (const auto& face : model.faces) {
+		FaceDirection faceDirection = GetFaceDirection(model, face);
         if (face.visibility != FaceDirection::none) {
-			FaceDirection direction = face.visibility;
-			Vector directionVec = model.faceDirectionVector[direction];
-			FaceDirection faceDirection = FaceDirection::none;
-			for (int i = 0; i < FaceDirection::none; i++) {
-				if (FaceDirectionVector[i] == directionVec) {
-					faceDirection = FaceDirection(i);
-					break;
-				}
-			}
 			if (faceDirection == FaceDirection::none)
 				continue;
 
@@ -128,9 +166,32 @@ void AddFacesByBlockModel(RendererSectionData& data, const BlockFaces& model, co
         }
 
         vertexData.layerAnimationAo.b = model.ambientOcclusion ? 1.0f : 0.0f;
+
+		//Only faces lying on the block boundary have a block layer in front of them
+		if (occluders && model.ambientOcclusion && faceDirection != FaceDirection::none) {
+			const Vector &dir = FaceDirectionVector[faceDirection];
+			Vector front = pos + dir;
+			for (size_t i = 0; i < 4; i++) {
+				glm::vec3 corner = vertexData.positions[i] - absPos - pos.glm();
+				Vector side1 = dir.x != 0 ? Vector(0, corner.y > 0.5f ? 1 : -1, 0) : Vector(corner.x > 0.5f ? 1 : -1, 0, 0);
+				Vector side2 = dir.z != 0 ? Vector(0, corner.y > 0.5f ? 1 : -1, 0) : Vector(0, 0, corner.z > 0.5f ? 1 : -1);
+				vertexData.cornerAo[i] = GetCornerAo(*occluders, front, side1, side2);
+			}
+		}
     }
 }
 
+//Liquid faces are added towards every neighbour which is not a flowing block of the same liquid
+size_t CountLiquidFaces(BlockId blockId, const Vector &pos, const SectionsData &sections) {
+	size_t count = 0;
+	for (size_t i = 0; i < FaceDirection::none; i++) {
+		const BlockId bid = sections.GetBlockId(pos + FaceDirectionVector[i]);
+		if (bid.id != blockId.id || (bid.state & 0b00000111) == 0)
+			count++;
+	}
+	return count;
+}
+
 void AddLiquidFacesByBlockModel(RendererSectionData& data, BlockId blockId, const BlockFaces& model, const glm::mat4& transform, bool visibility[FaceDirection::none], const Vector& pos, const SectionsData& sections, bool smoothLighting) {
 	const ParsedFace& flowData = model.faces[0];
 	const ParsedFace& stillData = model.faces[1];
@@ -382,8 +443,7 @@ BlockFaces *GetInternalBlockModel(BlockId id, std::vector<std::pair<BlockId, Blo
     return idModels.back().second;
 }
 
-std::array<bool[FaceDirection::none], 4096> GetBlockVisibilityData(const SectionsData &sections, const std::array<BlockId, 4096> &blockIdData, std::vector<std::pair<BlockId, BlockFaces*>> &idModels) {
-	std::array<bool[FaceDirection::none], 4096> arr;
+void GetBlockVisibilityData(const SectionsData &sections, std::vector<std::pair<BlockId, BlockFaces*>> &idModels, std::array<bool[FaceDirection::none], 4096> &arr) {
 	for (int y = 0; y < 16; y++) {
 		for (int z = 0; z < 16; z++) {
 			for (int x = 0; x < 16; x++) {
@@ -414,11 +474,21 @@ std::array<bool[FaceDirection::none], 4096> GetBlockVisibilityData(const Section
 			}
 		}
 	}
-	return arr;
 }
 
-std::array<BlockId, 4096> SetBlockIdData(const SectionsData &sections) {
-	std::array<BlockId, 4096> blockIdData;
+void GetOccluderData(const SectionsData &sections, std::vector<std::pair<BlockId, BlockFaces*>> &idModels, OccluderData &arr) {
+	for (int y = -1; y < 17; y++) {
+		for (int z = -1; z < 17; z++) {
+			for (int x = -1; x < 17; x++) {
+				BlockId blockId = sections.GetBlockId(Vector(x, y, z));
+				auto blockModel = GetInternalBlockModel(blockId, idModels);
+				arr[((y + 1) * 18 + (z + 1)) * 18 + (x + 1)] = blockId.id != 0 && !blockModel->faces.empty() && blockModel->isBlock;
+			}
+		}
+	}
+}
+
+void SetBlockIdData(const SectionsData &sections, std::array<BlockId, 4096> &blockIdData) {
 	for (int y = 0; y < 16; y++) {
 		for (int z = 0; z < 16; z++) {
 			for (int x = 0; x < 16; x++) {
@@ -426,19 +496,212 @@ std::array<BlockId, 4096> SetBlockIdData(const SectionsData &sections) {
 			}
 		}
 	}
-	return blockIdData;
 }
 
-RendererSectionData ParseSection(const SectionsData &sections, bool smoothLighting) {
-	OPTICK_EVENT();
-	RendererSectionData data;
+struct LodCell {
+	BlockId block{ 0, 0 };
+	Vector blockPos;
+	bool solid = false;
+	bool liquid = false;
+};
 
+//Per thread buffers reused by every ParseSection call, so meshing in steady state does not allocate
+struct MeshingScratch {
 	std::vector<std::pair<BlockId, BlockFaces*>> idModels;
-	std::array<BlockId, 4096> blockIdData = SetBlockIdData(sections);
-	std::array<bool[FaceDirection::none], 4096> blockVisibility = GetBlockVisibilityData(sections, blockIdData, idModels);
+	std::array<BlockId, 4096> blockIdData;
+	std::array<bool[FaceDirection::none], 4096> blockVisibility;
+	OccluderData occluders;
+	std::vector<LodCell> lodCells;
+
+	MeshingScratch() {
+		idModels.reserve(256);
+	}
+};
+
+thread_local MeshingScratch meshingScratch;
+
+//Builds simplified mesh for distant sections: blocks are grouped into cells of cellSize^3 blocks,
+//every mostly solid cell is rendered as one scaled cube of its topmost block, liquids only get top faces
+void ParseSectionLod(const SectionsData &sections, int lod, MeshingScratch &scratch, RendererSectionData &data) {
+	OPTICK_EVENT();
+	data.lod = lod;
+
+	const int cellSize = 1 << lod;
+	const int cellsCount = 16 / cellSize;
+	const int halfCellVolume = cellSize * cellSize * cellSize / 2;
+
+	std::vector<std::pair<BlockId, BlockFaces*>> &idModels = scratch.idModels;
+
+	//Cell coordinates can be outside of the section by one cell, neighbours are sampled from SectionsData
+	auto parseCell = [&](int cx, int cy, int cz) -> LodCell {
+		LodCell cell;
+		int solidCount = 0, liquidCount = 0;
+		for (int y = cellSize - 1; y >= 0; y--) {
+			for (int z = 0; z < cellSize; z++) {
+				for (int x = 0; x < cellSize; x++) {
+					Vector pos(cx * cellSize + x, cy * cellSize + y, cz * cellSize + z);
+					BlockId block = sections.GetBlockId(pos);
+					if (block.id == 0)
+						continue;
+					BlockFaces *model = GetInternalBlockModel(block, idModels);
+					if (model->isLiquid) {
+						liquidCount++;
+						if (cell.block.id == 0 && solidCount == 0) {
+							cell.block = block;
+							cell.blockPos = pos;
+						}
+					} else if (model->isBlock && !model->faces.empty()) {
+						if (solidCount++ == 0) {
+							cell.block = block;
+							cell.blockPos = pos;
+						}
+					}
+				}
+			}
+		}
+		cell.solid = solidCount > halfCellVolume - 1;
+		cell.liquid = !cell.solid && liquidCount > halfCellVolume - 1;
+		return cell;
+	};
+
+	const int gridSize = cellsCount + 2;
+	std::vector<LodCell> &cells = scratch.lodCells;
+	cells.assign(gridSize * gridSize * gridSize, LodCell());
+	auto getCell = [&](int cx, int cy, int cz) -> LodCell& {
+		return cells[((cy + 1) * gridSize + (cz + 1)) * gridSize + (cx + 1)];
+	};
+	{
+		HOT_SCOPE_TIME(MeshUnpackNs);
+		for (int cy = -1; cy <= cellsCount; cy++) {
+			for (int cz = -1; cz <= cellsCount; cz++) {
+				for (int cx = -1; cx <= cellsCount; cx++) {
+					int outside = (cx < 0 || cx >= cellsCount) + (cy < 0 || cy >= cellsCount) + (cz < 0 || cz >= cellsCount);
+					if (outside <= 1)
+						getCell(cx, cy, cz) = parseCell(cx, cy, cz);
+				}
+			}
+		}
+	}
+
+	auto getVisibility = [&](int cx, int cy, int cz, bool visibility[FaceDirection::none]) {
+		for (int i = 0; i < FaceDirection::none; i++) {
+			const Vector &dir = FaceDirectionVector[i];
+			visibility[i] = getCell(cx + dir.x, cy + dir.y, cz + dir.z).solid;
+		}
+	};
+
+	size_t solidFaces = 0, liquidFaces = 0;
+	{
+		HOT_SCOPE_TIME(MeshVisibilityNs);
+		for (int cy = 0; cy < cellsCount; cy++) {
+			for (int cz = 0; cz < cellsCount; cz++) {
+				for (int cx = 0; cx < cellsCount; cx++) {
+					const LodCell &cell = getCell(cx, cy, cz);
+					if (cell.solid) {
+						bool visibility[FaceDirection::none];
+						getVisibility(cx, cy, cz, visibility);
+						solidFaces += CountFacesByBlockModel(*GetInternalBlockModel(cell.block, idModels), visibility);
+					} else if (cell.liquid) {
+						const LodCell &upCell = getCell(cx, cy + 1, cz);
+						liquidFaces += !upCell.solid && !upCell.liquid;
+					}
+				}
+			}
+		}
+	}
+	data.solidVertices.reserve(solidFaces);
+	data.liquidVertices.reserve(liquidFaces);
+
+	HOT_SCOPE_TIME(MeshFacesNs);
+	glm::mat4 baseOffset = glm::translate(glm::mat4(1.0), (sections.data[1][1][1].GetPosition() * 16).glm());
+	for (int cy = 0; cy < cellsCount; cy++) {
+		for (int cz = 0; cz < cellsCount; cz++) {
+			for (int cx = 0; cx < cellsCount; cx++) {
+				const LodCell &cell = getCell(cx, cy, cz);
+				if (!cell.solid && !cell.liquid)
+					continue;
+
+				glm::mat4 transform = glm::translate(baseOffset, glm::vec3(cx, cy, cz) * static_cast<float>(cellSize));
+				transform = glm::scale(transform, glm::vec3(static_cast<float>(cellSize)));
 
-    data.hash = sections.data[1][1][1].GetHash();
-    data.sectionPos = sections.data[1][1][1].GetPosition();
+				BlockFaces *model = GetInternalBlockModel(cell.block, idModels);
+				if (cell.solid) {
+					bool visibility[FaceDirection::none];
+					getVisibility(cx, cy, cz, visibility);
+					AddFacesByBlockModel(data, *model, transform, visibility, cell.blockPos, sections, false);
+					continue;
+				}
+
+				const LodCell &upCell = getCell(cx, cy + 1, cz);
+				if (upCell.solid || upCell.liquid)
+					continue;
+
+				const ParsedFace &stillData = model->faces[1];
+				VertexData &vertex = data.liquidVertices.emplace_back();
+				vertex.positions[0] = transform * glm::vec4(0, 0.9f, 0, 1);
+				vertex.positions[1] = transform * glm::vec4(0, 0.9f, 1, 1);
+				vertex.positions[2] = transform * glm::vec4(1, 0.9f, 1, 1);
+				vertex.positions[3] = transform * glm::vec4(1, 0.9f, 0, 1);
+				vertex.uvs[0] = TransformTextureCoord(stillData.texture, glm::vec2(0, 0), stillData.frames);
+				vertex.uvs[1] = TransformTextureCoord(stillData.texture, glm::vec2(1, 0), stillData.frames);
+				vertex.uvs[2] = TransformTextureCoord(stillData.texture, glm::vec2(1, 1), stillData.frames);
+				vertex.uvs[3] = TransformTextureCoord(stillData.texture, glm::vec2(0, 1), stillData.frames);
+				vertex.normal = glm::vec3(0, 1, 0);
+				vertex.colors = glm::vec3(1.0f);
+				vertex.layerAnimationAo = glm::vec3(stillData.layer, stillData.frames, 0.0f);
+
+				BlockLightness light = sections.GetLight(cell.blockPos);
+				BlockLightness skyLight = sections.GetSkyLight(cell.blockPos);
+				glm::vec2 lightness(
+					(glm::max)(light.self, light.face[FaceDirection::up]),
+					(glm::max)(skyLight.self, skyLight.face[FaceDirection::up]));
+				for (size_t i = 0; i < 4; i++)
+					vertex.lights[i] = lightness;
+			}
+		}
+	}
+}
+
+void ParseSectionFull(const SectionsData &sections, bool smoothLighting, MeshingScratch &scratch, RendererSectionData &data) {
+	OPTICK_EVENT();
+	data.lod = 0;
+
+	std::vector<std::pair<BlockId, BlockFaces*>> &idModels = scratch.idModels;
+	std::array<BlockId, 4096> &blockIdData = scratch.blockIdData;
+	std::array<bool[FaceDirection::none], 4096> &blockVisibility = scratch.blockVisibility;
+	{
+		HOT_SCOPE_TIME(MeshUnpackNs);
+		SetBlockIdData(sections, blockIdData);
+	}
+
+	//Counting pass, so vertex vectors are reserved once with exact size
+	size_t solidFaces = 0, liquidFaces = 0;
+	{
+		HOT_SCOPE_TIME(MeshVisibilityNs);
+		GetBlockVisibilityData(sections, idModels, blockVisibility);
+		GetOccluderData(sections, idModels, scratch.occluders);
+
+		for (int y = 0; y < 16; y++) {
+			for (int z = 0; z < 16; z++) {
+				for (int x = 0; x < 16; x++) {
+					BlockId block = GetBlockId(x, y, z, blockIdData);
+					if (block.id == 0)
+						continue;
+
+					BlockFaces *model = GetInternalBlockModel(block, idModels);
+					if (model->isLiquid)
+						liquidFaces += CountLiquidFaces(block, Vector(x, y, z), sections);
+					else
+						solidFaces += CountFacesByBlockModel(*model, blockVisibility[y * 256 + z * 16 + x]);
+				}
+			}
+		}
+	}
+	data.solidVertices.reserve(solidFaces);
+	data.liquidVertices.reserve(liquidFaces);
+
+	//Includes MeshLightingNs of the emitted faces
+	HOT_SCOPE_TIME(MeshFacesNs);
 
     glm::mat4 baseOffset = glm::translate(glm::mat4(1.0), (sections.data[1][1][1].GetPosition() * 16).glm()), transform;
 
@@ -457,15 +720,45 @@ RendererSectionData ParseSection(const SectionsData &sections, bool smoothLighti
                 if (model->isLiquid)
                     AddLiquidFacesByBlockModel(data, block, *model, transform, blockVisibility[y * 256 + z * 16 + x], vec, sections, smoothLighting);
                 else
-                    AddFacesByBlockModel(data, *model, transform, blockVisibility[y * 256 + z * 16 + x], vec, sections, smoothLighting);
+                    AddFacesByBlockModel(data, *model, transform, blockVisibility[y * 256 + z * 16 + x], vec, sections, smoothLighting, &scratch.occluders);
 			}
 		}
 	}
+}
 
-	data.solidVertices.shrink_to_fit();
-	data.liquidVertices.shrink_to_fit();
-
-	return data;
+void ParseSection(const SectionsData &sections, bool smoothLighting, int lod, RendererSectionData &data) {
+	MeshingScratch &scratch = meshingScratch;
+	scratch.idModels.clear();
+
+	//Every buffer whose storage changed during parsing was allocated at least once
+	auto buffersState = [&]() {
+		return std::array<std::pair<const void*, size_t>, 4>{ {
+			{ scratch.idModels.data(), scratch.idModels.capacity() },
+			{ scratch.lodCells.data(), scratch.lodCells.capacity() },
+			{ data.solidVertices.data(), data.solidVertices.capacity() },
+			{ data.liquidVertices.data(), data.liquidVertices.capacity() },
+		} };
+	};
+	auto before = buffersState();
+
+	data.solidVertices.clear();
+	data.liquidVertices.clear();
+	data.hash = sections.data[1][1][1].GetHash();
+	data.sectionPos = sections.data[1][1][1].GetPosition();
+	data.forced = false;
+
+	if (lod > 0)
+		ParseSectionLod(sections, _min(lod, MaxSectionLod), scratch, data);
+	else
+		ParseSectionFull(sections, smoothLighting, scratch, data);
+
+	auto after = buffersState();
+	int allocations = 0;
+	for (size_t i = 0; i < before.size(); i++)
+		allocations += before[i] != after[i];
+	DebugInfo::meshesParsed++;
+	DebugInfo::meshAllocations += allocations;
+	HOT_COUNT_ADD(MeshFaces, data.solidVertices.size() + data.liquidVertices.size());
 }
 
 BlockId SectionsData::GetBlockId(const Vector &pos) const {
@@ -474,6 +767,7 @@ BlockId SectionsData::GetBlockId(const Vector &pos) const {
 }
 
 BlockLightness SectionsData::GetLight(const Vector& pos) const {
+    HOT_SCOPE_TIME(MeshLightingNs);
     BlockLightness lightness;
     for (size_t i = 0; i <= FaceDirection::none; i++) {
         Vector vec = pos + FaceDirectionVector[i];
@@ -488,6 +782,7 @@ BlockLightness SectionsData::GetLight(const Vector& pos) const {
 }
 
 BlockLightness SectionsData::GetSkyLight(const Vector &pos) const {
+    HOT_SCOPE_TIME(MeshLightingNs);
     BlockLightness lightness;
     for (size_t i = 0; i <= FaceDirection::none; i++) {
         Vector vec = pos + FaceDirectionVector[i];
@@ -65,6 +65,7 @@ struct VertexData {
     glm::vec3 normal;
     glm::vec3 colors;
     glm::vec3 layerAnimationAo; //R - uvLayer, G - animation, B - ambientOcclusion
+    glm::vec4 cornerAo = glm::vec4(1.0f); //baked voxel occlusion of every corner
 };
 
 struct RendererSectionData {
@@ -73,6 +74,11 @@ struct RendererSectionData {
     size_t hash = 0;
     Vector sectionPos;
     bool forced = false;
+    int lod = 0; //0 - full detail, N - blocks downsampled into 2^N cells
 };
 
-RendererSectionData ParseSection(const SectionsData &sections, bool smoothLighting);
+const int MaxSectionLod = 2;
+
+//Meshes into data reusing capacity of its vectors. Scratch buffers are kept per thread and vertices
+//are reserved by a counting pass, so meshing does not allocate once buffers reach their working size
+void ParseSection(const SectionsData &sections, bool smoothLighting, int lod, RendererSectionData &data);
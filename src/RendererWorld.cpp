@@ -1,5 +1,7 @@
  #include "RendererWorld.hpp"
 
+#include <limits>
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/norm.hpp>
@@ -14,6 +16,7 @@
 #include "RendererSectionData.hpp"
 #include "Game.hpp"
 #include "RenderConfigs.hpp"
+#include "ChunkCache.hpp"
 
 void RendererWorld::WorkerFunction(size_t workerId) {
 	OPTICK_THREAD("Worker");
@@ -26,8 +29,22 @@ void RendererWorld::WorkerFunction(size_t workerId) {
 			return;
 		size_t id = std::get<1>(data);
 		bool forced = std::get<2>(data);
-        parsing[id].renderer = ParseSection(parsing[id].data, smoothLighting);
+		ChunkCache *cache = parsing[id].cache.get();
+		if (!cache || forced || !cache->LoadMesh(parsing[id].data, smoothLighting, parsing[id].lod, parsing[id].renderer)) {
+			ParseSection(parsing[id].data, smoothLighting, parsing[id].lod, parsing[id].renderer);
+			if (cache)
+				cache->StoreMesh(parsing[id].data, parsing[id].renderer, smoothLighting);
+		}
 		parsing[id].renderer.forced = forced;
+		if (uploadThread) {
+			const RendererSectionData &renderer = parsing[id].renderer;
+			parsing[id].bufferUpload = uploadThread->UploadBuffers({
+				{ reinterpret_cast<const std::byte*>(renderer.solidVertices.data()), renderer.solidVertices.size() * sizeof(VertexData) },
+				{ reinterpret_cast<const std::byte*>(renderer.liquidVertices.data()), renderer.liquidVertices.size() * sizeof(VertexData) },
+				});
+		} else if (uploadRing) {
+			parsing[id].upload = RendererSection::Stage(parsing[id].renderer, *uploadRing);
+		}
 		PUSH_EVENT("SectionParsed", id);
 	});
 
@@ -41,14 +58,16 @@ void RendererWorld::WorkerFunction(size_t workerId) {
 
 void RendererWorld::ParseQueueUpdate() {
 	OPTICK_EVENT();
-	while (!parseQueue.empty()) {
+	std::shared_ptr<ChunkCache> cache = GetGameState()->GetWorld().GetCache();
+	while (!priorityParseQueue.empty() || !parseQueue.empty()) {
 		size_t id = 0;
 		for (; id < RendererWorld::parsingBufferSize && parsing[id].parsing; ++id) {}
 		if (id >= RendererWorld::parsingBufferSize)
 			break;
 
-		Vector vec = parseQueue.front();
-		parseQueue.pop();
+		std::queue<Vector> &queue = priorityParseQueue.empty() ? parseQueue : priorityParseQueue;
+		Vector vec = queue.front();
+		queue.pop();
 
 		bool forced = false;
 
@@ -56,7 +75,9 @@ void RendererWorld::ParseQueueUpdate() {
 			forced = true;
 			vec.y -= 4500;
 		}
-		
+
+		int lod = GetLodLevel(vec);
+
         for (int x = -1; x < 2; x++) {
             for (int y = -1; y < 2; y++) {
                 for (int z = -1; z < 2; z++) {
@@ -65,14 +86,169 @@ void RendererWorld::ParseQueueUpdate() {
             }
         }
 
+		parsing[id].lod = lod;
+		parsing[id].cache = cache;
 		parsing[id].parsing = true;
 
+		HOT_COUNT(MeshJobsStarted);
 		PUSH_EVENT("ParseSection", std::make_tuple(currentWorker++, id, forced));
 		if (currentWorker >= numOfWorkers)
 			currentWorker = 0;
 	}
 }
 
+void RendererWorld::ReleaseParsing(size_t id) {
+	SectionParsing &slot = parsing[id];
+	slot.data = SectionsData();
+	slot.upload = Gal::UploadAllocation();
+	slot.bufferUpload.reset();
+	slot.cache.reset();
+	slot.lod = 0;
+	slot.parsing = false;
+
+	//Vertex vectors are reused by the next section parsed in this slot, only unusually big ones are released
+	if (slot.renderer.solidVertices.capacity() > maxKeptParsingFaces)
+		std::vector<VertexData>().swap(slot.renderer.solidVertices);
+	if (slot.renderer.liquidVertices.capacity() > maxKeptParsingFaces)
+		std::vector<VertexData>().swap(slot.renderer.liquidVertices);
+}
+
+void RendererWorld::UploadingSlotsUpdate() {
+	OPTICK_EVENT();
+	for (auto it = uploadingSlots.begin(); it != uploadingSlots.end();) {
+		if (parsing[*it].bufferUpload->IsReady()) {
+			FinishParsing(*it);
+			it = uploadingSlots.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void RendererWorld::FinishParsing(size_t id) {
+	OPTICK_EVENT();
+	//Column may leave render distance while the section is meshed, DeleteSectionRender was not sent for it then
+	const Vector &sectionPos = parsing[id].renderer.sectionPos;
+	if (!viewRing.Contains(Vector(sectionPos.x, 0, sectionPos.z))) {
+		HOT_COUNT(MeshJobsDiscarded);
+		if (uploadRing)
+			uploadRing->Free(parsing[id].upload);
+		ReleaseParsing(id);
+		return;
+	}
+
+	auto it = sections.find(parsing[id].renderer.sectionPos);
+
+	if (it != sections.end() && parsing[id].renderer.hash == it->second.GetHash() && parsing[id].renderer.lod == it->second.GetLod() && !parsing[id].renderer.forced) {
+		LOG(WARNING) << "Generated not necessary RendererSectionData: " << parsing[id].renderer.sectionPos;
+		HOT_COUNT(MeshJobsDiscarded);
+		if (uploadRing)
+			uploadRing->Free(parsing[id].upload);
+		ReleaseParsing(id);
+		return;
+	}
+
+	UpdateSectionData(parsing[id].renderer, &parsing[id].upload, parsing[id].bufferUpload.get());
+	if (uploadRing)
+		uploadRing->Free(parsing[id].upload);
+
+	//Player may cross a level of detail threshold while the section is meshed, rings report it only once
+	if (parsing[id].renderer.lod != GetLodLevel(parsing[id].renderer.sectionPos))
+		PUSH_EVENT("ChunkChanged", parsing[id].renderer.sectionPos);
+
+	ReleaseParsing(id);
+}
+
+void RendererWorld::UpdateSectionData(const RendererSectionData &data, const Gal::UploadAllocation *upload, Gal::BufferUpload *bufferUpload) {
+	SplitRegionBatch(GetRegionBatchPos(data.sectionPos));
+	sectionsUpdateTime[data.sectionPos] = std::chrono::steady_clock::now();
+
+	if (upload && !upload->data)
+		upload = nullptr;
+
+	auto it = sections.find(data.sectionPos);
+	if (bufferUpload) {
+		auto buffers = bufferUpload->TakeBuffers();
+		RendererSection section(data, solidSectionsPipeline, solidSectionsBufferBinding, liquidSectionsPipeline, liquidSectionsBufferBinding, buffers[0], buffers[1]);
+		if (it != sections.end())
+			swap(it->second, section);
+		else
+			sections.try_emplace(data.sectionPos, std::move(section));
+		return;
+	}
+
+	if (it != sections.end() && upload)
+		it->second.UpdateData(data, *uploadRing, *upload);
+	else if (it != sections.end())
+		it->second.UpdateData(data);
+	else
+		sections.try_emplace(data.sectionPos, RendererSection(data, solidSectionsPipeline, solidSectionsBufferBinding, liquidSectionsPipeline, liquidSectionsBufferBinding, uploadRing.get(), upload));
+}
+
+void RendererWorld::RemoveSection(const Vector &sectionPos) {
+	deferredSections.erase(sectionPos);
+	SplitRegionBatch(GetRegionBatchPos(sectionPos));
+	sectionsUpdateTime.erase(sectionPos);
+	sections.erase(sectionPos);
+}
+
+Vector RendererWorld::GetRegionBatchPos(const Vector &sectionPos) {
+	return Vector(std::floor(sectionPos.x / static_cast<double>(regionBatchSize)), 0, std::floor(sectionPos.z / static_cast<double>(regionBatchSize)));
+}
+
+void RendererWorld::SplitRegionBatch(const Vector &regionPos) {
+	auto it = regionBatches.find(regionPos);
+	if (it == regionBatches.end())
+		return;
+	for (const auto &member : it->second.members)
+		batchedSections.erase(member);
+	regionBatches.erase(it);
+}
+
+void RendererWorld::UpdateRegionBatches() {
+	OPTICK_EVENT();
+	auto now = std::chrono::steady_clock::now();
+
+	//Region can be merged only if every its section is a stable low detail one
+	std::map<Vector, std::vector<Vector>> regionMembers;
+	std::set<Vector> notSuitableRegions;
+	for (auto &it : sections) {
+		Vector regionPos = GetRegionBatchPos(it.first);
+		if (regionBatches.find(regionPos) != regionBatches.end() || notSuitableRegions.count(regionPos))
+			continue;
+
+		auto updateTime = sectionsUpdateTime.find(it.first);
+		bool stable = updateTime != sectionsUpdateTime.end() && now - updateTime->second > std::chrono::seconds(regionBatchStableSeconds);
+		if (!stable || it.second.GetLod() == 0) {
+			notSuitableRegions.insert(regionPos);
+			regionMembers.erase(regionPos);
+			continue;
+		}
+		regionMembers[regionPos].push_back(it.first);
+	}
+
+	for (auto &region : regionMembers) {
+		if (region.second.size() < 2)
+			continue;
+
+		//Members are copied on GPU from their own buffers, no vertices are kept on CPU for batching
+		std::vector<const RendererSection*> members;
+		glm::vec3 minPos(std::numeric_limits<float>::max()), maxPos(std::numeric_limits<float>::lowest());
+		for (const auto &member : region.second) {
+			members.push_back(&sections.at(member));
+			minPos = glm::min(minPos, (member * 16).glm());
+			maxPos = glm::max(maxPos, ((member + Vector(1, 1, 1)) * 16).glm());
+		}
+
+		glm::vec3 center = (minPos + maxPos) * 0.5f;
+		float radius = glm::length(maxPos - minPos) * 0.5f;
+		regionBatches.try_emplace(region.first, RegionBatch{
+			RendererSection(region.first, members, solidSectionsPipeline, solidSectionsBufferBinding, liquidSectionsPipeline, liquidSectionsBufferBinding),
+			region.second, center, radius });
+		batchedSections.insert(region.second.begin(), region.second.end());
+	}
+}
+
 void RendererWorld::ParseQeueueRemoveUnnecessary() {
 	OPTICK_EVENT();
 	size_t size = parseQueue.size();
@@ -89,24 +265,29 @@ void RendererWorld::ParseQeueueRemoveUnnecessary() {
 			continue;
 		}
 
-		if (std::find(elements.begin(), elements.end(), vec) != elements.end())
+		if (std::find(elements.begin(), elements.end(), vec) != elements.end()) {
+			HOT_COUNT(MeshJobsCancelled);
 			continue;
+		}
 				
 		const Section& section = GetGameState()->GetWorld().GetSection(vec);
 
 		bool skip = false;
 
 		for (int i = 0; i < RendererWorld::parsingBufferSize; i++) {
-            if (parsing[i].data.data[1][1][1].GetHash() == section.GetHash()) {
+            if (parsing[i].data.data[1][1][1].GetHash() == section.GetHash() && parsing[i].lod == GetLodLevel(vec)) {
 				skip = true;
 				break;
 			}
 		}
-		if (skip)
+		if (skip) {
+			HOT_COUNT(MeshJobsCancelled);
 			continue;
+		}
 
 		auto it = sections.find(vec);
-		if (it != sections.end() && section.GetHash() == it->second.GetHash()) {
+		if (it != sections.end() && section.GetHash() == it->second.GetHash() && it->second.GetLod() == GetLodLevel(vec)) {
+			HOT_COUNT(MeshJobsCancelled);
 			continue;
 		}
 
@@ -117,46 +298,162 @@ void RendererWorld::ParseQeueueRemoveUnnecessary() {
 	parseQueueNeedRemoveUnnecessary = false;
 }
 
-void RendererWorld::UpdateAllSections(VectorF playerPos) {
+void RendererWorld::ParseQueueRemoveOutOfView(std::queue<Vector> &queue) {
 	OPTICK_EVENT();
-    Vector playerChunk(std::floor(playerPos.x / 16), 0, std::floor(playerPos.z / 16));
+	size_t size = queue.size();
+	for (size_t i = 0; i < size; i++) {
+		Vector vec = queue.front();
+		queue.pop();
 
-    std::vector<Vector> suitableChunks;
-    auto chunks = GetGameState()->GetWorld().GetSectionsList();
-    for (auto& it : chunks) {
-        double distance = (Vector(it.x, 0, it.z) - playerChunk).GetLength();
-        if (distance > MaxRenderingDistance)
-            continue;
-        suitableChunks.push_back(it);
+		Vector column(vec.x, 0, vec.z);
+		if (!viewRing.Contains(column)) {
+			HOT_COUNT(MeshJobsCancelled);
+			continue;
+		}
+
+		queue.push(vec);
+	}
+}
+
+bool RendererWorld::IsNeighboursLoaded(const Vector &sectionPos) {
+	//Vertical neighbours arrive in the same column packet
+	const World &world = GetGameState()->GetWorld();
+	return world.IsColumnLoaded(sectionPos.x + 1, sectionPos.z) &&
+		world.IsColumnLoaded(sectionPos.x - 1, sectionPos.z) &&
+		world.IsColumnLoaded(sectionPos.x, sectionPos.z + 1) &&
+		world.IsColumnLoaded(sectionPos.x, sectionPos.z - 1);
+}
+
+void RendererWorld::DeferredSectionsUpdate() {
+	OPTICK_EVENT();
+	auto now = std::chrono::steady_clock::now();
+	for (auto it = deferredSections.begin(); it != deferredSections.end();) {
+		if (now - it->second >= std::chrono::milliseconds(deferredMeshTimeoutMs) || IsNeighboursLoaded(it->first)) {
+			parseQueue.push(it->first);
+			parseQueueNeedRemoveUnnecessary = true;
+			it = deferredSections.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+int RendererWorld::GetLodLevel(const Vector &sectionPos) {
+    if (LodDistance <= 0)
+        return 0;
+
+    double distance = (Vector(sectionPos.x, 0, sectionPos.z) - lodCenter).GetLength();
+
+    //Every next level starts twice as far as the previous one
+    int lod = 0;
+    for (double threshold = LodDistance; lod < MaxSectionLod && distance > threshold; threshold *= 2)
+        lod++;
+
+    //Keep current level near the thresholds, so sections don't flip back and forth while player walks along the border
+    auto it = sections.find(sectionPos);
+    if (it != sections.end() && it->second.GetLod() != lod) {
+        const double hysteresis = lodHysteresis;
+        int currentLod = it->second.GetLod();
+        double currentBegin = currentLod == 0 ? 0.0 : LodDistance * (1 << (currentLod - 1));
+        double currentEnd = currentLod == MaxSectionLod ? MaxRenderingDistance + hysteresis : LodDistance * (1 << currentLod);
+        if (distance > currentBegin - hysteresis && distance <= currentEnd + hysteresis)
+            return currentLod;
     }
+    return lod;
+}
 
-    std::vector<Vector> toRemove;
+void RendererWorld::UpdateLodRings(const Vector &playerChunk, std::vector<Vector> &crossing) {
+    std::vector<double> radii;
+    if (LodDistance > 0) {
+        for (int lod = 0; lod < MaxSectionLod; lod++) {
+            double threshold = LodDistance * (1 << lod);
+            radii.push_back(_max(0.0, threshold - lodHysteresis));
+            radii.push_back(threshold);
+            radii.push_back(threshold + lodHysteresis);
+        }
+    }
 
-    for (auto& it : sections) {
-        if (std::find(suitableChunks.begin(), suitableChunks.end(), it.first) == suitableChunks.end())
-            toRemove.push_back(it.first);
+    lodRings.resize(radii.size());
+    for (size_t i = 0; i < radii.size(); i++)
+        lodRings[i].Update(playerChunk, radii[i], crossing, crossing);
+}
+
+void RendererWorld::UpdateAllSections(VectorF playerPos, bool force) {
+	OPTICK_EVENT();
+    Vector playerChunk(std::floor(playerPos.x / 16), 0, std::floor(playerPos.z / 16));
+
+    if (force)
+        viewRing.Reset();
+    std::vector<Vector> entering, leaving;
+    if (!viewRing.Update(playerChunk, MaxRenderingDistance, entering, leaving))
+        return;
+
+    for (auto& column : leaving) {
+        for (int y = 0; y < 16; y++) {
+            Vector sectionPos(column.x, y, column.z);
+            if (sections.find(sectionPos) != sections.end() || deferredSections.find(sectionPos) != deferredSections.end())
+                PUSH_EVENT("DeleteSectionRender", sectionPos);
+        }
+    }
+    if (!leaving.empty()) {
+        ParseQueueRemoveOutOfView(parseQueue);
+        ParseQueueRemoveOutOfView(priorityParseQueue);
     }
 
-    for (auto& it : toRemove) {
-		PUSH_EVENT("DeleteSectionRender", it);
+    std::vector<Vector> toUpdate;
+    const World& world = GetGameState()->GetWorld();
+    for (auto& column : entering) {
+        for (int y = 0; y < 16; y++) {
+            Vector sectionPos(column.x, y, column.z);
+            if (world.GetSectionPtr(sectionPos))
+                toUpdate.push_back(sectionPos);
+        }
     }
 
-    playerChunk.y = std::floor(GetGameState()->GetPlayer()->pos.y / 16.0);
-    std::sort(suitableChunks.begin(), suitableChunks.end(), [playerChunk](Vector lhs, Vector rhs) {
+    //Sections whose level of detail no longer matches the distance are remeshed through the usual
+    //ChunkChanged path, nearest first, the old mesh stays visible until the new one is ready
+    std::vector<Vector> lodColumns;
+    lodCenter = playerChunk;
+    UpdateLodRings(playerChunk, lodColumns);
+    if (force) {
+        for (auto& it : sections) {
+            if (!viewRing.Contains(Vector(it.first.x, 0, it.first.z))) {
+                PUSH_EVENT("DeleteSectionRender", it.first);
+                continue;
+            }
+            if (it.second.GetLod() != GetLodLevel(it.first))
+                toUpdate.push_back(it.first);
+        }
+    } else {
+        std::sort(lodColumns.begin(), lodColumns.end());
+        lodColumns.erase(std::unique(lodColumns.begin(), lodColumns.end()), lodColumns.end());
+        for (auto& column : lodColumns) {
+            for (int y = 0; y < 16; y++) {
+                Vector sectionPos(column.x, y, column.z);
+                auto it = sections.find(sectionPos);
+                if (it != sections.end() && it->second.GetLod() != GetLodLevel(sectionPos))
+                    toUpdate.push_back(sectionPos);
+            }
+        }
+    }
+
+    playerChunk.y = std::floor(playerPos.y / 16.0);
+    std::sort(toUpdate.begin(), toUpdate.end(), [playerChunk](Vector lhs, Vector rhs) {
         double leftLengthToPlayer = (playerChunk - lhs).GetLength();
         double rightLengthToPlayer = (playerChunk - rhs).GetLength();
         return leftLengthToPlayer < rightLengthToPlayer;
     });
 
-    for (auto& it : suitableChunks) {
+    for (auto& it : toUpdate) {
 		PUSH_EVENT("ChunkChanged", it);
-    }	
+    }
 }
 
-RendererWorld::RendererWorld(std::shared_ptr<Gal::Framebuffer> target, bool defferedShading, bool smoothLighting) {
+RendererWorld::RendererWorld(std::shared_ptr<Gal::Framebuffer> target, bool defferedShading, bool smoothLighting, bool backgroundUploads) {
     OPTICK_EVENT();
     this->smoothLighting = smoothLighting;
     MaxRenderingDistance = 2;
+    LodDistance = 0;
     numOfWorkers = _max(1, (signed int) std::thread::hardware_concurrency() - 2);
 
     listener = std::make_unique<EventListener>();
@@ -168,30 +465,17 @@ RendererWorld::RendererWorld(std::shared_ptr<Gal::Framebuffer> target, bool deff
     listener->RegisterHandler("DeleteSectionRender", [this](const Event& eventData) {
 		OPTICK_EVENT("EV_DeleteSectionRender");
 		auto vec = eventData.get<Vector>();
-        auto it = sections.find(vec);
-        if (it == sections.end())
-            return;
-        sections.erase(it);
+        RemoveSection(vec);
     });
 
     listener->RegisterHandler("SectionParsed",[this](const Event &eventData) {
 		OPTICK_EVENT("EV_SectionParsed");
 		auto id = eventData.get<size_t>();
-		parsing[id].parsing = false;
-
-		auto it = sections.find(parsing[id].renderer.sectionPos);
-
-		if (it != sections.end()) {
-			if (parsing[id].renderer.hash == it->second.GetHash() && !parsing[id].renderer.forced) {
-				LOG(WARNING) << "Generated not necessary RendererSectionData: " << parsing[id].renderer.sectionPos;
-				parsing[id] = RendererWorld::SectionParsing();
-				return;
-			}
-			it->second.UpdateData(parsing[id].renderer);
-		} else
-			sections.try_emplace(parsing[id].renderer.sectionPos, RendererSection(parsing[id].renderer, solidSectionsPipeline, solidSectionsBufferBinding, liquidSectionsPipeline, liquidSectionsBufferBinding));
-
-		parsing[id] = RendererWorld::SectionParsing();
+		if (parsing[id].bufferUpload && !parsing[id].bufferUpload->IsReady()) {
+			uploadingSlots.push_back(id);
+			return;
+		}
+		FinishParsing(id);
     });
     
     listener->RegisterHandler("EntityChanged", [this](const Event& eventData) {
@@ -210,13 +494,19 @@ RendererWorld::RendererWorld(std::shared_ptr<Gal::Framebuffer> target, bool deff
 		if (vec == Vector())
 			return;
 
-        Vector playerChunk(std::floor(GetGameState()->GetPlayer()->pos.x / 16), 0, std::floor(GetGameState()->GetPlayer()->pos.z / 16));
+        Vector playerChunk(std::floor(snapshot.playerPos.x / 16), 0, std::floor(snapshot.playerPos.z / 16));
 
         double distanceToChunk = (Vector(vec.x, 0, vec.z) - playerChunk).GetLength();
         if (distanceToChunk > MaxRenderingDistance) {
             return;
         }
 
+		if (sections.find(vec) == sections.end() && !IsNeighboursLoaded(vec)) {
+			deferredSections.try_emplace(vec, std::chrono::steady_clock::now());
+			return;
+		}
+		deferredSections.erase(vec);
+
 		parseQueue.push(vec);
 
 		parseQueueNeedRemoveUnnecessary = true;
@@ -228,7 +518,7 @@ RendererWorld::RendererWorld(std::shared_ptr<Gal::Framebuffer> target, bool deff
 		if (vec == Vector())
 			return;
 
-		Vector playerChunk(std::floor(GetGameState()->GetPlayer()->pos.x / 16), 0, std::floor(GetGameState()->GetPlayer()->pos.z / 16));
+		Vector playerChunk(std::floor(snapshot.playerPos.x / 16), 0, std::floor(snapshot.playerPos.z / 16));
 
 		double distanceToChunk = (Vector(vec.x, 0, vec.z) - playerChunk).GetLength();
 		if (distanceToChunk > MaxRenderingDistance) {
@@ -242,8 +532,32 @@ RendererWorld::RendererWorld(std::shared_ptr<Gal::Framebuffer> target, bool deff
 		parseQueueNeedRemoveUnnecessary = true;
 	});
 
+	//Sections without a mesh yet are not visible, they go through the usual path with neighbours check
+	listener->RegisterHandler("ChunkChangedPriority", [this](const Event& eventData) {
+		OPTICK_EVENT("EV_ChunkChangedPriority");
+		auto vec = eventData.get<Vector>();
+		if (sections.find(vec) == sections.end()) {
+			PUSH_EVENT("ChunkChanged", vec);
+			return;
+		}
+
+		priorityParseQueue.push(vec);
+	});
+
+	listener->RegisterHandler("ChunkChangedPriorityForce", [this](const Event& eventData) {
+		OPTICK_EVENT("EV_ChunkChangedPriorityForce");
+		auto vec = eventData.get<Vector>();
+		if (sections.find(vec) == sections.end()) {
+			PUSH_EVENT("ChunkChangedForce", vec);
+			return;
+		}
+
+		vec.y += 4500;
+		priorityParseQueue.push(vec);
+	});
+
     listener->RegisterHandler("UpdateSectionsRender", [this](const Event&) {
-        UpdateAllSections(GetGameState()->GetPlayer()->pos);
+        UpdateAllSections(snapshot.playerPos, true);
     });
 
     listener->RegisterHandler("PlayerPosChanged", [this](const Event& eventData) {
@@ -253,11 +567,13 @@ RendererWorld::RendererWorld(std::shared_ptr<Gal::Framebuffer> target, bool deff
 
     listener->RegisterHandler("ChunkDeleted", [this](const Event& eventData) {
 		auto pos = eventData.get<Vector>();
-        auto it = sections.find(pos);
-        if (it != sections.end())
-            sections.erase(it);
+        RemoveSection(pos);
     });
 
+    uploadRing = Gal::GetImplementation()->GetUploadRing();
+    if (backgroundUploads)
+        uploadThread = Gal::GetImplementation()->GetUploadThread();
+
     for (int i = 0; i < numOfWorkers; i++)
         workers.emplace_back(&RendererWorld::WorkerFunction, this, i);
 
@@ -274,6 +590,12 @@ RendererWorld::~RendererWorld() {
     isRunning = false;
     for (int i = 0; i < numOfWorkers; i++)
         workers[i].join();
+    if (uploadThread)
+        uploadThread->Flush();
+    if (uploadRing) {
+        for (auto &it : parsing)
+            uploadRing->Free(it.upload);
+    }
     DebugInfo::renderSections = 0;
     DebugInfo::readyRenderer = 0;
 }
@@ -293,22 +615,28 @@ void RendererWorld::Render(float screenRatio) {
     globalSpb->Get<GlobalShaderParameters>()->invProj = glm::inverse(projection);
 
     auto& view = globalSpb->Get<GlobalShaderParameters>()->view;
-    view = GetGameState()->GetViewMatrix();
+    view = snapshot.view;
 
     auto& projView = globalSpb->Get<GlobalShaderParameters>()->projView;
     projView = projection * view;
 
+    auto gpuTimer = Gal::GetImplementation()->GetGpuTimer();
+
     //Render Entities
+    gpuTimer->BeginScope("Entities");
     constexpr size_t entitiesVerticesCount = 240;
     entitiesPipeline->Activate();
     entitiesPipelineInstance->Activate();
     for (auto& it : entities) {
-        it.Render(entitiesPipeline, &GetGameState()->GetWorld());
+        const RenderSnapshot::EntityTransform *transform = snapshot.GetEntity(it.GetEntityId());
+        if (!transform)
+            continue;
+        it.Render(entitiesPipeline, *transform);
         entitiesPipelineInstance->Render(0, entitiesVerticesCount);
     }
 
     //Render selected block
-    Vector selectedBlock = GetGameState()->GetSelectionStatus().selectedBlock;
+    Vector selectedBlock = snapshot.selectedBlock;
     if (selectedBlock != Vector()) {
         {
             glm::mat4 model = glm::mat4(1.0);
@@ -324,7 +652,7 @@ void RendererWorld::Render(float screenRatio) {
     //Render raycast hit
     const bool renderHit = false;
     if (renderHit) {
-        VectorF hit = GetGameState()->GetSelectionStatus().raycastHit;
+        VectorF hit = snapshot.raycastHit;
         {
             glm::mat4 model;
             model = glm::translate(model, hit.glm());
@@ -349,6 +677,10 @@ void RendererWorld::Render(float screenRatio) {
     size_t culledSections = sections.size();
     unsigned int renderedFaces = 0;
     for (auto& section : sections) { 
+        if (batchedSections.find(section.first) != batchedSections.end()) {
+            culledSections--;
+            continue;
+        }
         const auto& sectionPos = section.second.GetPosition();
         glm::vec3 point{
             sectionPos.x * 16 + 8,
@@ -366,27 +698,44 @@ void RendererWorld::Render(float screenRatio) {
         renderedFaces += section.second.GetSolidFacesCount();
         renderedFaces += section.second.GetLiquidFacesCount();
     }
-    glm::vec3 playerChunk(GetGameState()->GetPlayer()->pos / 16);
+    glm::vec3 playerChunk(snapshot.playerPos / 16);
     std::sort(renderList.begin(), renderList.end(), [playerChunk](const Vector& lhs, const Vector& rhs) {
         return glm::distance2(lhs.glm(), playerChunk) < glm::distance2(rhs.glm(), playerChunk);
         });
+    batchesRenderList.clear();
+    for (auto& batch : regionBatches) {
+        if (!frustum.TestSphere(batch.second.center, batch.second.radius))
+            continue;
+        batchesRenderList.push_back(batch.first);
+        culledSections += batch.second.members.size();
+        renderedFaces += batch.second.section.GetSolidFacesCount();
+        renderedFaces += batch.second.section.GetLiquidFacesCount();
+    }
+    gpuTimer->BeginScope("Sections");
     solidSectionsPipeline->Activate();
     for (const auto& renderPos : renderList) {
         sections.at(renderPos).RenderSolid();
     }
+    for (const auto& regionPos : batchesRenderList) {
+        regionBatches.at(regionPos).section.RenderSolid();
+    }
+    gpuTimer->BeginScope("Liquids");
     liquidSectionsPipeline->Activate();
     for (const auto& renderPos : renderList) {
         sections.at(renderPos).RenderLiquid();
     }
+    for (const auto& regionPos : batchesRenderList) {
+        regionBatches.at(regionPos).section.RenderLiquid();
+    }
     DebugInfo::culledSections = culledSections;
     DebugInfo::renderFaces = renderedFaces;
 
     //Render sky
     glm::mat4 model = glm::mat4(1.0);
-    model = glm::translate(model, GetGameState()->GetPlayer()->pos.glm());
+    model = glm::translate(model, snapshot.playerPos.glm());
     const float scale = 1000000.0f;
     model = glm::scale(model, glm::vec3(scale, scale, scale));
-    float shift = GetGameState()->GetTimeStatus().interpolatedTimeOfDay / 24000.0f;
+    float shift = snapshot.interpolatedTimeOfDay / 24000.0f;
     if (shift < 0)
         shift *= -1.0f;
     model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0, 1.0f, 0.0f));
@@ -400,7 +749,7 @@ void RendererWorld::Render(float screenRatio) {
     const float moonriseLength = moonriseMax - moonriseMin;
 
     float mixLevel = 0;
-    float dayTime = GetGameState()->GetTimeStatus().interpolatedTimeOfDay;
+    float dayTime = snapshot.interpolatedTimeOfDay;
     if (dayTime < 0)
         dayTime *= -1;
     while (dayTime > 24000)
@@ -418,10 +767,12 @@ void RendererWorld::Render(float screenRatio) {
 
     globalSpb->Get<GlobalShaderParameters>()->dayTime = mixLevel;
 
+    gpuTimer->BeginScope("Sky");
     skyPipeline->Activate();
     skyPipeline->SetShaderParameter("model", model);
     skyPipelineInstance->Activate();
     skyPipelineInstance->Render(0, 36);
+    gpuTimer->EndScope();
 }
 
 void RendererWorld::PrepareRender(std::shared_ptr<Gal::Framebuffer> target, bool defferedShading) {
@@ -480,6 +831,7 @@ void RendererWorld::PrepareRender(std::shared_ptr<Gal::Framebuffer> target, bool
             {"normal", Gal::Type::Vec3, 1, 1},
             {"color", Gal::Type::Vec3, 1, 1},
             {"layerAnimationAo", Gal::Type::Vec3, 1, 1},
+            {"cornerAo", Gal::Type::Vec4, 1, 1},
             });
         solidSectionsPipeline = gal->BuildPipeline(solidSectionPLC);
     }
@@ -499,6 +851,7 @@ void RendererWorld::PrepareRender(std::shared_ptr<Gal::Framebuffer> target, bool
             {"normal", Gal::Type::Vec3, 1, 1},
             {"color", Gal::Type::Vec3, 1, 1},
             {"layerAnimationAo", Gal::Type::Vec3, 1, 1},
+            {"", Gal::Type::Vec4, 1, 1},
             });
         liquidSectionsPipeline = gal->BuildPipeline(liquidSectionPLC);
     }
@@ -753,19 +1106,33 @@ void RendererWorld::PrepareRender(std::shared_ptr<Gal::Framebuffer> target, bool
     }
 }
 
+void RendererWorld::SetSnapshot(RenderSnapshot &&snapshot) {
+    this->snapshot = std::move(snapshot);
+}
+
+void RendererWorld::EndFrame() {
+	//Copies from the upload ring were issued in Update, their memory is fenced with this frame
+	if (uploadRing)
+		uploadRing->EndFrame();
+}
+
 void RendererWorld::Update(double timeToUpdate) {
 	OPTICK_EVENT();
     static auto timeSincePreviousUpdate = std::chrono::steady_clock::now();
 
+	DeferredSectionsUpdate();
+
 	if (parseQueueNeedRemoveUnnecessary)
 		ParseQeueueRemoveUnnecessary();
 
 	ParseQueueUpdate();
 
 	listener->HandleAllEvents();
+
+	UploadingSlotsUpdate();
     
     if (std::chrono::steady_clock::now() - timeSincePreviousUpdate > std::chrono::seconds(5)) {
-		PUSH_EVENT("UpdateSectionsRender", 0);
+        UpdateRegionBatches();
         timeSincePreviousUpdate = std::chrono::steady_clock::now();
     }
 
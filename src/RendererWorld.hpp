@@ -1,6 +1,8 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <chrono>
 #include <vector>
 #include <mutex>
 #include <queue>
@@ -10,6 +12,8 @@
 #include "RendererSection.hpp"
 #include "RendererEntity.hpp"
 #include "RendererSectionData.hpp"
+#include "RenderSnapshot.hpp"
+#include "ViewRing.hpp"
 
 class Frustum;
 class GameState;
@@ -17,16 +21,30 @@ class Texture;
 class Shader;
 class EventListener;
 class RenderState;
+class ChunkCache;
 
 class RendererWorld {
+    struct RegionBatch {
+        RendererSection section;
+        std::vector<Vector> members;
+        glm::vec3 center;
+        float radius;
+    };
+
     struct SectionParsing {
         SectionsData data;
         RendererSectionData renderer;
+        Gal::UploadAllocation upload;
+        std::shared_ptr<Gal::BufferUpload> bufferUpload;
+        //Mesh is looked up in and stored to the cache by the worker, so disk reads never stall the render thread
+        std::shared_ptr<ChunkCache> cache;
+        int lod = 0;
         bool parsing = false;
     };
 
     //General
     std::unique_ptr<EventListener> listener;
+    RenderSnapshot snapshot;
     size_t numOfWorkers;
     size_t currentWorker = 0;
     std::vector<std::thread> workers;
@@ -34,19 +52,61 @@ class RendererWorld {
     bool isRunning = true;
     const static size_t parsingBufferSize = 64;
     SectionParsing parsing[parsingBufferSize];
+    //Every slot keeps vertex capacity up to this many faces,
+    //so at most parsingBufferSize * 2 * maxKeptParsingFaces faces stay allocated between sections
+    const static size_t maxKeptParsingFaces = 2048;
+    void ReleaseParsing(size_t id);
     std::queue<Vector> parseQueue;
+    //Sections changed by the player, meshed before everything else
+    std::queue<Vector> priorityParseQueue;
     bool parseQueueNeedRemoveUnnecessary = false;
     void ParseQueueUpdate();
     void ParseQeueueRemoveUnnecessary();
+    //Drops queued sections whose columns left the view ring
+    void ParseQueueRemoveOutOfView(std::queue<Vector> &queue);
+    //Meshes are written into the upload ring by workers, so the render thread only issues GPU copies
+    std::shared_ptr<Gal::UploadRing> uploadRing;
+    //Meshes are uploaded into new buffers by the upload thread, slots wait in uploadingSlots until the upload is fenced
+    std::shared_ptr<Gal::UploadThread> uploadThread;
+    std::vector<size_t> uploadingSlots;
+    void UploadingSlotsUpdate();
+    void FinishParsing(size_t id);
+    void UpdateSectionData(const RendererSectionData &data, const Gal::UploadAllocation *upload = nullptr, Gal::BufferUpload *bufferUpload = nullptr);
+    void RemoveSection(const Vector &sectionPos);
+    //New sections wait here until their horizontal neighbours are loaded or timeout passes, so border faces
+    //are not meshed against missing sections and meshed again when the neighbours arrive
+    const static int deferredMeshTimeoutMs = 1500;
+    std::map<Vector, std::chrono::steady_clock::time_point> deferredSections;
+    bool IsNeighboursLoaded(const Vector &sectionPos);
+    void DeferredSectionsUpdate();
     //Blocks
     std::vector<Vector> renderList;
     std::map<Vector, RendererSection> sections;
-    void UpdateAllSections(VectorF playerPos);
+    //Schedules only columns entering and leaving the view ring, force rebuilds the whole ring
+    ViewRing viewRing;
+    void UpdateAllSections(VectorF playerPos, bool force = false);
+    //Level of detail of a column changes only when it crosses a threshold or its hysteresis band,
+    //rings at these radii yield the columns to check, so moving does not visit every loaded section
+    static constexpr double lodHysteresis = 1.0;
+    std::vector<ViewRing> lodRings;
+    Vector lodCenter; //player column of the last ring update, levels of detail are computed against it
+    void UpdateLodRings(const Vector &playerChunk, std::vector<Vector> &crossing);
+    int GetLodLevel(const Vector &sectionPos);
     std::chrono::time_point<std::chrono::high_resolution_clock> globalTimeStart;
     std::shared_ptr<Gal::Pipeline> solidSectionsPipeline;
     std::shared_ptr<Gal::BufferBinding> solidSectionsBufferBinding;
     std::shared_ptr<Gal::Pipeline> liquidSectionsPipeline;
     std::shared_ptr<Gal::BufferBinding> liquidSectionsBufferBinding;
+    //Region batches, far sections merged into one buffer per regionBatchSize x regionBatchSize columns
+    const static int regionBatchSize = 4;
+    const static int regionBatchStableSeconds = 10;
+    std::map<Vector, std::chrono::steady_clock::time_point> sectionsUpdateTime;
+    std::map<Vector, RegionBatch> regionBatches;
+    std::set<Vector> batchedSections;
+    std::vector<Vector> batchesRenderList;
+    static Vector GetRegionBatchPos(const Vector &sectionPos);
+    void UpdateRegionBatches();
+    void SplitRegionBatch(const Vector &regionPos);
     //Entities
     std::vector<RendererEntity> entities;
     std::shared_ptr<Gal::Pipeline> entitiesPipeline;
@@ -57,7 +117,7 @@ class RendererWorld {
     std::shared_ptr<Gal::PipelineInstance> skyPipelineInstance;
     std::shared_ptr<Gal::Buffer> skyBuffer;
 public:
-    RendererWorld(std::shared_ptr<Gal::Framebuffer> target, bool defferedShading, bool smoothLighting);
+    RendererWorld(std::shared_ptr<Gal::Framebuffer> target, bool defferedShading, bool smoothLighting, bool backgroundUploads = false);
     ~RendererWorld();
 
     void Render(float screenRatio);
@@ -65,7 +125,16 @@ public:
 
     double MaxRenderingDistance;
 
+    //Distance in chunks after which sections are meshed with lower level of detail
+    double LodDistance;
+
     void Update(double timeToUpdate);
 
+    //Fences upload ring memory freed this frame, called every frame even if the world is not rendered
+    void EndFrame();
+
+    //Game state the next frames are rendered with, everything else is read from GameState only in Update
+    void SetSnapshot(RenderSnapshot &&snapshot);
+
     bool smoothLighting;
 };
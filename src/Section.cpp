@@ -3,6 +3,9 @@
 #include <bitset>
 #include <cstring>
 
+#include "DebugInfo.hpp"
+#include "Stream.hpp"
+
 void Section::CalculateHash() const {
     if (block.empty()) {
         hash = 0;
@@ -52,6 +55,7 @@ Section::Section(Vector pos, unsigned char bitsPerBlock, std::vector<unsigned sh
 }
 
 BlockId Section::GetBlockId(Vector pos) const {
+    HOT_COUNT(SectionGetBlockId);
     if (block.empty())
         return BlockId{ 0,0 };
 
@@ -85,6 +89,7 @@ BlockId Section::GetBlockId(Vector pos) const {
 
     if (t >= palette.size()) {
         //LOG(ERROR) << "Out of palette: " << t;
+        HOT_COUNT(SectionPaletteMiss);
         value = t;
     }
     else
@@ -124,4 +129,58 @@ size_t Section::GetHash() const {
     if (hash == -1)
         CalculateHash();
     return hash;
-}
\ No newline at end of file
+}
+
+void Section::Serialize(StreamOutput *data) const {
+    data->WriteUByte(bitsPerBlock);
+    data->WriteVarInt(palette.size());
+    for (unsigned short it : palette)
+        data->WriteVarInt(it);
+    data->WriteVarInt(block.size());
+    for (long long it : block)
+        data->WriteLong(it);
+    data->WriteByteArray(std::vector<unsigned char>(light, light + 2048));
+    data->WriteByteArray(std::vector<unsigned char>(sky, sky + 2048));
+    data->WriteVarInt(overrideList.size());
+    for (auto& it : overrideList) {
+        data->WriteUByte(it.first.x);
+        data->WriteUByte(it.first.y);
+        data->WriteUByte(it.first.z);
+        data->WriteUShort(it.second.id << 4 | it.second.state);
+    }
+}
+
+Section Section::Deserialize(StreamInput *data, const Vector& position) {
+    unsigned char bitsPerBlock = data->ReadUByte();
+
+    int paletteLength = data->ReadVarInt();
+    std::vector<unsigned short> palette;
+    palette.reserve(paletteLength);
+    for (int i = 0; i < paletteLength; i++)
+        palette.push_back(data->ReadVarInt());
+
+    int blockLength = data->ReadVarInt();
+    std::vector<long long> blockArray;
+    blockArray.reserve(blockLength);
+    for (int i = 0; i < blockLength; i++)
+        blockArray.push_back(data->ReadLong());
+
+    auto blockLight = data->ReadByteArray(2048);
+    auto skyLight = data->ReadByteArray(2048);
+
+    Section section(position, bitsPerBlock, std::move(palette), std::move(blockArray), blockLight, skyLight);
+
+    int overridesCount = data->ReadVarInt();
+    for (int i = 0; i < overridesCount; i++) {
+        Vector pos;
+        pos.x = data->ReadUByte();
+        pos.y = data->ReadUByte();
+        pos.z = data->ReadUByte();
+        unsigned short value = data->ReadUShort();
+        section.overrideList[pos] = BlockId{ (unsigned short)(value >> 4), (unsigned char)(value & 0xF) };
+    }
+    if (overridesCount > 0)
+        section.CalculateHash();
+
+    return section;
+}
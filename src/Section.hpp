@@ -6,6 +6,9 @@
 #include "Block.hpp"
 #include "Vector.hpp"
 
+class StreamInput;
+class StreamOutput;
+
 class Section {
     std::vector<long long> block;
 	unsigned char light[2048] = {};
@@ -39,4 +42,9 @@ public:
 	Vector GetPosition() const;
 
     size_t GetHash() const;
+
+    //Writes section in network-like format followed by block overrides, used by ChunkCache
+    void Serialize(StreamOutput *data) const;
+
+    static Section Deserialize(StreamInput *data, const Vector& position);
 };
\ No newline at end of file
@@ -93,7 +93,7 @@ TextureAtlas::TextureAtlas(std::vector<TextureData> &textures) {
 
 	texture = gal->BuildTexture(texConfig);
 
-	//Uploading texture data
+	//Uploading texture data, all rectangles are staged and uploaded at once
 	for (int i = 0; i < textureCoords.size(); i++) {
 		size_t bytesPerLine = textureCoords[i].pixelW * 4;
 		auto& textureData = textures[i].data;
@@ -105,7 +105,7 @@ TextureAtlas::TextureAtlas(std::vector<TextureData> &textures) {
 				std::swap(*(src + j), *(dst + j));
 			}
 		}
-		texture->SetSubData(
+		texture->QueueSubData(
 			textureCoords[i].pixelX,
 			textureSize - textureCoords[i].pixelY - textureCoords[i].pixelH,
 			textureCoords[i].layer,
@@ -115,6 +115,7 @@ TextureAtlas::TextureAtlas(std::vector<TextureData> &textures) {
 			{ reinterpret_cast<std::byte*>(textureData.data()), reinterpret_cast<std::byte*>(textureData.data()) + textureData.size() }
 		);
 	}
+	texture->FlushSubData();
 
 	LOG(INFO) << "Texture atlas initialized";
 }
@@ -1,13 +1,15 @@
 #include "Utility.hpp"
 
+#include <cmath>
 #include <thread>
 
 #include <optick.h>
 #include <easylogging++.h>
 
-LoopExecutionTimeController::LoopExecutionTimeController(duration delayLength)
-        : delayLength(delayLength) {
+LoopExecutionTimeController::LoopExecutionTimeController(duration delayLength, bool spinWait)
+        : delayLength(delayLength), spinWait(spinWait) {
     previousUpdate = clock::now();
+    statsWindowStart = previousUpdate;
 }
 
 void LoopExecutionTimeController::SetDelayLength(duration length) {
@@ -18,13 +20,57 @@ unsigned long long LoopExecutionTimeController::GetIterations() {
     return iterations;
 }
 
+void LoopExecutionTimeController::WaitUntil(timePoint deadline) {
+    if (!spinWait) {
+        std::this_thread::sleep_until(deadline);
+        return;
+    }
+
+    const duration minSpin(0.25);
+    const duration maxSpin(4.0);
+    const duration spinSafety(0.2);
+
+    //Sleep while the deadline is further than the OS timer usually oversleeps
+    while (true) {
+        duration spinMargin = std::clamp(sleepOvershoot + spinSafety, minSpin, maxSpin);
+        duration timeToSleep = duration(deadline - clock::now()) - spinMargin;
+        if (timeToSleep.count() <= 0)
+            break;
+        timePoint sleepStart = clock::now();
+        std::this_thread::sleep_for(timeToSleep);
+        duration overshoot = duration(clock::now() - sleepStart) - timeToSleep;
+
+        //Peak follower, grows at once and decays slowly
+        sleepOvershoot = std::max(overshoot, sleepOvershoot * 0.95);
+    }
+
+    while (clock::now() < deadline)
+        std::this_thread::yield();
+}
+
 void LoopExecutionTimeController::Update() {
+    OPTICK_EVENT();
     iterations++;
-    auto timeToSleep = delayLength - GetDelta();    
-    if (timeToSleep.count() > 0)
-        std::this_thread::sleep_for(timeToSleep);
+    timePoint deadline = previousUpdate + std::chrono::duration_cast<clock::duration>(delayLength);
+    if (delayLength.count() > 0)
+        WaitUntil(deadline);
     previousPreviousUpdate = previousUpdate;
-    previousUpdate = clock::now();    
+    previousUpdate = clock::now();
+
+    if (delayLength.count() <= 0)
+        return;
+
+    const double statsFactor = 0.05;
+    duration error = _max(duration(previousUpdate - deadline), duration(0.0));
+    pacingError += (error - pacingError) * statsFactor;
+    pacingErrorWindowMax = _max(pacingErrorWindowMax, error);
+    duration jitter = duration(std::abs((duration(previousUpdate - previousPreviousUpdate) - delayLength).count()));
+    frameJitter += (jitter - frameJitter) * statsFactor;
+    if (previousUpdate - statsWindowStart >= std::chrono::seconds(1)) {
+        pacingErrorMax = pacingErrorWindowMax;
+        pacingErrorWindowMax = duration(0.0);
+        statsWindowStart = previousUpdate;
+    }
 }
 
 double LoopExecutionTimeController::GetDeltaMs() {
@@ -50,3 +96,15 @@ double LoopExecutionTimeController::RemainTimeMs() {
     auto remain = delayLength - GetDelta();
     return remain.count();
 }
+
+double LoopExecutionTimeController::GetPacingErrorMs() {
+    return pacingError.count();
+}
+
+double LoopExecutionTimeController::GetPacingErrorMaxMs() {
+    return pacingErrorMax.count();
+}
+
+double LoopExecutionTimeController::GetFrameJitterMs() {
+    return frameJitter.count();
+}
@@ -45,6 +45,12 @@ inline void endswap(unsigned char *arr, size_t arrLen) {
 
 #define glCheckError()
 
+/*
+ * Paces loop iterations to delayLength. Iteration end is slept to shortly before
+ * the deadline and spun for the rest, the spin margin follows the observed
+ * oversleep of the OS timer, so iterations end at the deadline without the
+ * 1-2 ms overshoot of a plain sleep.
+ */
 class LoopExecutionTimeController {
     using clock = std::chrono::steady_clock ;
     using timePoint = std::chrono::time_point<clock>;
@@ -53,8 +59,19 @@ class LoopExecutionTimeController {
     timePoint previousPreviousUpdate;
     duration delayLength;
     unsigned long long iterations=0;
+    //Pacing
+    bool spinWait;
+    duration sleepOvershoot = duration(1.0);
+    duration pacingError = duration(0.0);
+    duration pacingErrorMax = duration(0.0);
+    duration pacingErrorWindowMax = duration(0.0);
+    duration frameJitter = duration(0.0);
+    timePoint statsWindowStart;
+
+    void WaitUntil(timePoint deadline);
 public:
-    LoopExecutionTimeController(duration delayLength);
+    //spinWait sleeps only to the OS timer precision and yields the rest, for loops that need exact pacing
+    LoopExecutionTimeController(duration delayLength, bool spinWait = false);
 
     void SetDelayLength(duration length);
 
@@ -71,4 +88,13 @@ public:
     double GetRealDeltaS();
 
     double RemainTimeMs();
+
+    //Average lateness of iteration end relative to its deadline
+    double GetPacingErrorMs();
+
+    //Worst lateness during the previous second
+    double GetPacingErrorMaxMs();
+
+    //Average deviation of iteration length from delayLength
+    double GetFrameJitterMs();
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "ViewRing.hpp"
+
+#include <cmath>
+
+#include "Utility.hpp"
+
+int ViewRing::GetRowHalfWidth(double radius, long long dz) {
+    double squared = radius * radius - static_cast<double>(dz) * static_cast<double>(dz);
+    if (squared < 0)
+        return -1;
+    return static_cast<int>(std::floor(std::sqrt(squared)));
+}
+
+void ViewRing::AppendRowDifference(long long z, long long begin, long long end, long long excludeBegin, long long excludeEnd, std::vector<Vector> &columns) {
+    if (excludeBegin > excludeEnd) {
+        for (long long x = begin; x <= end; x++)
+            columns.push_back(Vector(x, 0, z));
+        return;
+    }
+    for (long long x = begin; x <= _min(end, excludeBegin - 1); x++)
+        columns.push_back(Vector(x, 0, z));
+    for (long long x = _max(begin, excludeEnd + 1); x <= end; x++)
+        columns.push_back(Vector(x, 0, z));
+}
+
+bool ViewRing::Update(const Vector &newCenter, double newRadius, std::vector<Vector> &entering, std::vector<Vector> &leaving) {
+    if (valid && newCenter.x == center.x && newCenter.z == center.z && newRadius == radius)
+        return false;
+
+    long long oldExtent = valid ? static_cast<long long>(std::floor(radius)) : -1;
+    long long newExtent = static_cast<long long>(std::floor(newRadius));
+    long long zBegin = newCenter.z - newExtent;
+    long long zEnd = newCenter.z + newExtent;
+    if (valid) {
+        zBegin = _min(zBegin, center.z - oldExtent);
+        zEnd = _max(zEnd, center.z + oldExtent);
+    }
+
+    for (long long z = zBegin; z <= zEnd; z++) {
+        int oldHalfWidth = valid ? GetRowHalfWidth(radius, z - center.z) : -1;
+        int newHalfWidth = GetRowHalfWidth(newRadius, z - newCenter.z);
+        long long oldBegin = center.x - oldHalfWidth, oldEnd = center.x + oldHalfWidth;
+        long long newBegin = newCenter.x - newHalfWidth, newEnd = newCenter.x + newHalfWidth;
+        if (newHalfWidth < 0) {
+            newBegin = 0;
+            newEnd = -1;
+        }
+        if (oldHalfWidth < 0) {
+            oldBegin = 0;
+            oldEnd = -1;
+        }
+        if (newBegin <= newEnd)
+            AppendRowDifference(z, newBegin, newEnd, oldBegin, oldEnd, entering);
+        if (oldBegin <= oldEnd)
+            AppendRowDifference(z, oldBegin, oldEnd, newBegin, newEnd, leaving);
+    }
+
+    center = Vector(newCenter.x, 0, newCenter.z);
+    radius = newRadius;
+    valid = true;
+    return true;
+}
+
+void ViewRing::Reset() {
+    valid = false;
+}
+
+bool ViewRing::Contains(const Vector &column) const {
+    if (!valid)
+        return false;
+    int halfWidth = GetRowHalfWidth(radius, column.z - center.z);
+    return halfWidth >= 0 && std::abs(column.x - center.x) <= halfWidth;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include "Vector.hpp"
+
+/*
+ * Set of chunk columns within render distance of the player.
+ * Columns are kept implicitly as a disc of rows around the center column, so
+ * moving the center or changing the radius yields only the columns entering and
+ * leaving the disc, row by row, without visiting the columns that stay in view.
+ */
+class ViewRing {
+    Vector center;
+    double radius = 0.0;
+    bool valid = false;
+
+    //Row z of the disc spans [center.x - halfWidth, center.x + halfWidth], -1 if row is out of disc
+    static int GetRowHalfWidth(double radius, long long dz);
+
+    static void AppendRowDifference(long long z, long long begin, long long end, long long excludeBegin, long long excludeEnd, std::vector<Vector> &columns);
+
+public:
+    //Returns false if nothing changed, columns are (x, 0, z)
+    bool Update(const Vector &newCenter, double newRadius, std::vector<Vector> &entering, std::vector<Vector> &leaving);
+
+    //Next Update treats every column of the disc as entering
+    void Reset();
+
+    bool Contains(const Vector &column) const;
+};
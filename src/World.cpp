@@ -9,6 +9,8 @@
 #include "DebugInfo.hpp"
 #include "Packet.hpp"
 #include "Collision.hpp"
+#include "ChunkCache.hpp"
+#include "JobPool.hpp"
 
 std::map<int, Dimension> registeredDimensions;
 
@@ -23,6 +25,16 @@ World::World(int dimensionId) : dimension(dimensionId) {
 void World::ParseChunkData(std::shared_ptr<PacketChunkData> packet) {
     StreamBuffer chunkData(packet->Data.data(), packet->Data.size());
     std::bitset<16> bitmask(packet->PrimaryBitMask);
+    DropPendingEdits(packet->ChunkX, packet->ChunkZ);
+
+    if (packet->GroundUpContinuous && cachedColumns.erase(Vector(packet->ChunkX, 0, packet->ChunkZ))) {
+        for (auto& section : GetColumn(packet->ChunkX, packet->ChunkZ)) {
+            Vector pos = section->GetPosition();
+            if (!bitmask[pos.y])
+                PUSH_EVENT("ChunkDeleted", pos);
+            sections.erase(pos);
+        }
+    }
     for (int i = 0; i < 16; i++) {
         if (bitmask[i]) {
             Vector chunkPosition = Vector(packet->ChunkX, i, packet->ChunkZ);
@@ -130,6 +142,14 @@ bool World::isPlayerCollides(double X, double Y, double Z) const {
     return false;
 }
 
+bool World::IsColumnLoaded(int chunkX, int chunkZ) const {
+    for (int y = 0; y < 16; y++) {
+        if (sections.find(Vector(chunkX, y, chunkZ)) != sections.end())
+            return true;
+    }
+    return false;
+}
+
 static Section fallbackSection;
 
 const Section &World::GetSection(const Vector& sectionPos) const {
@@ -164,16 +184,16 @@ RaycastResult World::Raycast(const glm::vec3& position, const glm::vec3& directi
     return result;
 }
 
-void World::UpdatePhysics(float delta) {
-	OPTICK_EVENT();
-    struct CollisionResult {
-        bool isCollide;
-        //Vector block;
-        //VectorF pos; 
-        //VectorF dir;
-    };
+namespace {
+    //Entities fewer than this are simulated on the calling thread
+    constexpr size_t minEntitiesPerJob = 16;
+
+    JobPool &GetPhysicsJobs() {
+        static JobPool jobs(_min(4u, _max(1u, std::thread::hardware_concurrency() / 2)) - 1);
+        return jobs;
+    }
 
-    auto testCollision = [this](double width, double height, VectorF pos)->CollisionResult {
+    bool TestEntityCollision(const World &world, double width, double height, VectorF pos) {
 		OPTICK_EVENT("testCollision");
         int blockXBegin = pos.x - width - 1.0;
         int blockXEnd = pos.x + width + 0.5;
@@ -194,26 +214,24 @@ void World::UpdatePhysics(float delta) {
         for (int y = blockYBegin; y <= blockYEnd; y++) {
             for (int z = blockZBegin; z <= blockZEnd; z++) {
                 for (int x = blockXBegin; x <= blockXEnd; x++) {
-					OPTICK_EVENT("testCollision");
-					BlockId block = this->GetBlockId(Vector(x, y, z));
+					BlockId block = world.GetBlockId(Vector(x, y, z));
 					if (block.id == 0 || !GetBlockInfo(block)->collides)
 						continue;
                     AABB blockColl{ (double)x,(double)y,(double)z,1.0,1.0,1.0 };
                     if (TestCollision(entityCollBox, blockColl)) {
-                        return { true };
+                        return true;
                     }
                 }
             }
         }
-        return { false };
-    };
+        return false;
+    }
 
-    for (auto& it : entities) {
-		OPTICK_EVENT("Foreach entities");
+    //Reads only the world blocks and writes only the entity, so entities may be simulated in parallel
+    void SimulateLocalEntity(const World &world, Entity &it, float delta) {
 		if (it.isFlying) {
 			VectorF newPos = it.pos + VectorF(it.vel.x, it.vel.y, it.vel.z) * delta;
-			auto coll = testCollision(it.width, it.height, newPos);
-			if (coll.isCollide) {
+			if (TestEntityCollision(world, it.width, it.height, newPos)) {
 				it.vel = VectorF(0, 0, 0);
 			}
 			else {
@@ -224,14 +242,13 @@ void World::UpdatePhysics(float delta) {
 			VectorF resistForce = it.vel * AirResistance * delta * -1.0;
 			it.vel = it.vel + resistForce;
 
-			continue;
+			return;
 		}
 
         { //Vertical velocity
             it.vel.y -= it.gravity * delta;
             VectorF newPos = it.pos + VectorF(0, it.vel.y, 0) * delta;
-            auto coll = testCollision(it.width, it.height, newPos);
-            if (coll.isCollide) {
+            if (TestEntityCollision(world, it.width, it.height, newPos)) {
                 it.vel = VectorF(it.vel.x, 0, it.vel.z);
                 it.onGround = true;
             }
@@ -242,20 +259,40 @@ void World::UpdatePhysics(float delta) {
 
         { //Horizontal velocity
             VectorF newPos = it.pos + VectorF(it.vel.x, 0, it.vel.z) * delta;
-            auto coll = testCollision(it.width, it.height, newPos);
-            if (coll.isCollide) {
+            if (TestEntityCollision(world, it.width, it.height, newPos)) {
                 it.vel = VectorF(0, it.vel.y, 0);
             }
             else {
                 it.pos = newPos;
             }
 
-            const float AirResistance = 10.0f;
-            VectorF resistForce = it.vel * AirResistance * delta * -1.0;
+            VectorF resistForce = it.vel * it.drag * delta * -1.0;
             resistForce.y = 0.0;
             it.vel = it.vel + resistForce;
         }
     }
+}
+
+void World::UpdatePhysics(float delta) {
+	OPTICK_EVENT();
+    auto stepStart = std::chrono::steady_clock::now();
+
+    std::vector<Entity*> localEntities;
+    for (auto& it : entities) {
+		if (it.simulation == SimulationMode::Remote)
+			it.Extrapolate(delta);
+		else
+			localEntities.push_back(&it);
+    }
+
+    GetPhysicsJobs().ParallelFor(localEntities.size(), minEntitiesPerJob, [&](size_t begin, size_t end) {
+        OPTICK_EVENT("SimulateEntities");
+        for (size_t i = begin; i < end; i++)
+            SimulateLocalEntity(*this, *localEntities[i], delta);
+    });
+
+    DebugInfo::physicsEntities = localEntities.size();
+    DebugInfo::physicsStepTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stepStart).count();
     DebugInfo::totalSections = sections.size();
 }
 
@@ -311,11 +348,14 @@ void World::DeleteEntity(unsigned int EntityId) {
 }
 
 void World::ParseChunkData(std::shared_ptr<PacketBlockChange> packet) {
-    SetBlockId(packet->Position,
-               BlockId {
-                   (unsigned short) (packet->BlockId >> 4),
-                   (unsigned char) (packet->BlockId & 0xF)
-               });
+    BlockId block {
+        (unsigned short) (packet->BlockId >> 4),
+        (unsigned char) (packet->BlockId & 0xF)
+    };
+    if (!ResolvePendingEdit(packet->Position, block))
+        return;
+
+    SetBlockId(packet->Position, block);
 
     Vector sectionPos(std::floor(packet->Position.x / 16.0),
                       std::floor(packet->Position.y / 16.0),
@@ -330,7 +370,10 @@ void World::ParseChunkData(std::shared_ptr<PacketMultiBlockChange> packet) {
         int y = it.YCoordinate;
         int z = (it.HorizontalPosition & 15) + (packet->ChunkZ * 16);
         Vector worldPos(x, y, z);
-        SetBlockId(worldPos, BlockId{(unsigned short) (it.BlockId >> 4),(unsigned char) (it.BlockId & 0xF) });
+        BlockId block{(unsigned short) (it.BlockId >> 4),(unsigned char) (it.BlockId & 0xF) };
+        if (!ResolvePendingEdit(worldPos, block))
+            continue;
+        SetBlockId(worldPos, block);
 
         Vector sectionPos(packet->ChunkX, std::floor(it.YCoordinate / 16.0), packet->ChunkZ);
         if (std::find(changedSections.begin(), changedSections.end(), sectionPos) == changedSections.end())
@@ -342,6 +385,11 @@ void World::ParseChunkData(std::shared_ptr<PacketMultiBlockChange> packet) {
 }
 
 void World::ParseChunkData(std::shared_ptr<PacketUnloadChunk> packet) {
+    DropPendingEdits(packet->ChunkX, packet->ChunkZ);
+    if (cache && !cachedColumns.count(Vector(packet->ChunkX, 0, packet->ChunkZ)))
+        cache->StoreColumn(packet->ChunkX, packet->ChunkZ, GetColumn(packet->ChunkX, packet->ChunkZ));
+    cachedColumns.erase(Vector(packet->ChunkX, 0, packet->ChunkZ));
+
     std::vector<std::map<Vector, std::shared_ptr<Section>>::iterator> toRemove;
     for (auto it = sections.begin(); it != sections.end(); ++it) {
         if (it->first.x == packet->ChunkX && it->first.z == packet->ChunkZ)
@@ -354,6 +402,63 @@ void World::ParseChunkData(std::shared_ptr<PacketUnloadChunk> packet) {
     UpdateSectionsList();
 }
 
+void World::SetCache(std::shared_ptr<ChunkCache> chunkCache) {
+    cache = std::move(chunkCache);
+}
+
+std::vector<std::shared_ptr<Section>> World::GetColumn(int chunkX, int chunkZ) const {
+    std::vector<std::shared_ptr<Section>> column;
+    for (auto it = sections.lower_bound(Vector(chunkX, 0, chunkZ)); it != sections.end() && it->first.x == chunkX; ++it) {
+        if (it->first.z == chunkZ)
+            column.push_back(it->second);
+    }
+    return column;
+}
+
+void World::LoadCachedColumns(int centerX, int centerZ, int radius) {
+    OPTICK_EVENT();
+    if (!cache)
+        return;
+
+    size_t loadedColumns = 0;
+    std::vector<Section> column;
+    for (int x = centerX - radius; x <= centerX + radius; x++) {
+        for (int z = centerZ - radius; z <= centerZ + radius; z++) {
+            if (!GetColumn(x, z).empty())
+                continue;
+
+            column.clear();
+            if (!cache->LoadColumn(x, z, column) || column.empty())
+                continue;
+
+            for (auto& section : column) {
+                Vector pos = section.GetPosition();
+                sections.try_emplace(pos, std::make_shared<Section>(std::move(section)));
+                PUSH_EVENT("ChunkChanged", pos);
+            }
+            cachedColumns.insert(Vector(x, 0, z));
+            loadedColumns++;
+        }
+    }
+    UpdateSectionsList();
+    LOG(INFO) << "Loaded " << loadedColumns << " columns from chunk cache";
+}
+
+void World::StoreToCache() const {
+    OPTICK_EVENT();
+    if (!cache)
+        return;
+
+    std::map<Vector, std::vector<std::shared_ptr<Section>>> columns;
+    for (auto& it : sections) {
+        Vector columnPos(it.first.x, 0, it.first.z);
+        if (!cachedColumns.count(columnPos))
+            columns[columnPos].push_back(it.second);
+    }
+    for (auto& it : columns)
+        cache->StoreColumn(it.first.x, it.first.z, it.second);
+}
+
 void World::UpdateSectionsList() {
     sectionsList.clear();
     for (auto& it : sections) {
@@ -370,32 +475,103 @@ BlockId World::GetBlockId(const Vector& pos) const {
     return !section ? BlockId{0, 0} : section->GetBlockId(pos - (sectionPos * 16));
 }
 
-void World::SetBlockId(const Vector& pos, BlockId block) {
+bool World::StoreBlockId(const Vector& pos, BlockId block) {
     Vector sectionPos(std::floor(pos.x / 16.0),
                       std::floor(pos.y / 16.0),
                       std::floor(pos.z / 16.0));
-	Vector blockPos = pos - (sectionPos * 16);
     const Section* sectionPtr = GetSectionPtr(sectionPos);
     if (!sectionPtr) {
         LOG(ERROR) << "Updating unloaded chunk " << sectionPos;
-        return;
+        return false;
     }
     auto section = std::make_shared<Section>(*sectionPtr);
-    section->SetBlockId(blockPos, block);
+    section->SetBlockId(pos - (sectionPos * 16), block);
 	sections[sectionPos] = section;
-    PUSH_EVENT("ChunkChanged",sectionPos);
+    return true;
+}
+
+void World::PushBlockChanged(const Vector& pos, bool priority) {
+    Vector sectionPos(std::floor(pos.x / 16.0),
+                      std::floor(pos.y / 16.0),
+                      std::floor(pos.z / 16.0));
+	Vector blockPos = pos - (sectionPos * 16);
+    const char *changed = priority ? "ChunkChangedPriority" : "ChunkChanged";
+    const char *neighbourChanged = priority ? "ChunkChangedPriorityForce" : "ChunkChangedForce";
+    PUSH_EVENT(changed, sectionPos);
 	if (blockPos.x == 0)
-		PUSH_EVENT("ChunkChangedForce", sectionPos + Vector(-1, 0, 0));
+		PUSH_EVENT(neighbourChanged, sectionPos + Vector(-1, 0, 0));
 	if (blockPos.x == 15)
-		PUSH_EVENT("ChunkChangedForce", sectionPos + Vector(1, 0, 0));
+		PUSH_EVENT(neighbourChanged, sectionPos + Vector(1, 0, 0));
 	if (blockPos.y == 0)
-		PUSH_EVENT("ChunkChangedForce", sectionPos + Vector(0, -1, 0));
+		PUSH_EVENT(neighbourChanged, sectionPos + Vector(0, -1, 0));
 	if (blockPos.y == 15)
-		PUSH_EVENT("ChunkChangedForce", sectionPos + Vector(0, 1, 0));
+		PUSH_EVENT(neighbourChanged, sectionPos + Vector(0, 1, 0));
 	if (blockPos.z == 0)
-		PUSH_EVENT("ChunkChangedForce", sectionPos + Vector(0, 0, -1));
+		PUSH_EVENT(neighbourChanged, sectionPos + Vector(0, 0, -1));
 	if (blockPos.z == 15)
-		PUSH_EVENT("ChunkChangedForce", sectionPos + Vector(0, 0, 1));
+		PUSH_EVENT(neighbourChanged, sectionPos + Vector(0, 0, 1));
+}
+
+void World::SetBlockId(const Vector& pos, BlockId block) {
+    if (StoreBlockId(pos, block))
+        PushBlockChanged(pos, false);
+}
+
+void World::PredictBlockId(const Vector& pos, BlockId block) {
+    if (!GetSectionPtr(Vector(std::floor(pos.x / 16.0), std::floor(pos.y / 16.0), std::floor(pos.z / 16.0))))
+        return;
+
+    BlockId previous = GetBlockId(pos);
+    auto it = pendingEdits.find(pos);
+    if (it != pendingEdits.end())
+        previous = it->second.previous;
+    pendingEdits[pos] = PendingEdit{ ++editSequence, block, previous, std::chrono::steady_clock::now() };
+
+    if (StoreBlockId(pos, block))
+        PushBlockChanged(pos, true);
+}
+
+bool World::ResolvePendingEdit(const Vector& pos, BlockId block) {
+    auto it = pendingEdits.find(pos);
+    if (it == pendingEdits.end())
+        return true;
+
+    bool confirmed = it->second.predicted == block;
+    pendingEdits.erase(it);
+    if (confirmed)
+        return false;
+
+    //Server rejected or changed the edit, correct it as soon as possible
+    if (StoreBlockId(pos, block))
+        PushBlockChanged(pos, true);
+    return false;
+}
+
+void World::DropPendingEdits(int chunkX, int chunkZ) {
+    for (auto it = pendingEdits.begin(); it != pendingEdits.end();) {
+        if (std::floor(it->first.x / 16.0) == chunkX && std::floor(it->first.z / 16.0) == chunkZ)
+            it = pendingEdits.erase(it);
+        else
+            ++it;
+    }
+}
+
+void World::UpdatePendingEdits() {
+    const auto timeout = std::chrono::seconds(2);
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = pendingEdits.begin(); it != pendingEdits.end();) {
+        if (now - it->second.time < timeout) {
+            ++it;
+            continue;
+        }
+        LOG(WARNING) << "Block edit " << it->second.sequence << " at " << it->first << " is not confirmed by server, rolling back";
+        Vector pos = it->first;
+        BlockId previous = it->second.previous;
+        bool isUnchanged = GetBlockId(pos) == it->second.predicted;
+        it = pendingEdits.erase(it);
+        if (isUnchanged && StoreBlockId(pos, previous))
+            PushBlockChanged(pos, true);
+    }
 }
 
 void World::SetBlockLight(const Vector& pos, unsigned char light) {
@@ -407,6 +583,7 @@ void World::SetBlockSkyLight(const Vector& pos, unsigned char light) {
 }
 
 const Section *World::GetSectionPtr(const Vector& position) const {
+    HOT_COUNT(WorldGetSectionPtr);
     auto it = sections.find(position);
 
     if (it == sections.end())
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <queue>
 #include <memory>
 #include <vector>
 #include <list>
+#include <chrono>
 
 #include <easylogging++.h>
 
@@ -18,6 +20,7 @@ class PacketBlockChange;
 class PacketMultiBlockChange;
 class PacketUnloadChunk;
 class StreamInput;
+class ChunkCache;
 
 struct RaycastResult {
     bool isHit;
@@ -45,6 +48,35 @@ class World {
 
     void UpdateSectionsList();
 
+    std::shared_ptr<ChunkCache> cache;
+
+    //Columns loaded from cache and not yet confirmed by server
+    std::set<Vector> cachedColumns;
+
+    std::vector<std::shared_ptr<Section>> GetColumn(int chunkX, int chunkZ) const;
+
+    //Block edits applied locally before server confirmed them
+    struct PendingEdit {
+        unsigned int sequence;
+        BlockId predicted;
+        BlockId previous;
+        std::chrono::steady_clock::time_point time;
+    };
+    std::map<Vector, PendingEdit> pendingEdits;
+    unsigned int editSequence = 0;
+
+    //Server state of pos has arrived, returns true if pos has no predicted edit and the caller must apply it.
+    //A predicted edit changed by server is corrected here
+    bool ResolvePendingEdit(const Vector& pos, BlockId block);
+
+    //Returns false if section of pos is not loaded, renderer is not notified
+    bool StoreBlockId(const Vector& pos, BlockId block);
+
+    //Remeshes section of pos and its neighbours touching pos, priority ones before all queued sections
+    void PushBlockChanged(const Vector& pos, bool priority);
+
+    void DropPendingEdits(int chunkX, int chunkZ);
+
 public:
 
 	World() = default;
@@ -59,12 +91,23 @@ public:
 
     void ParseChunkData(std::shared_ptr<PacketUnloadChunk> packet);
 
+    void SetCache(std::shared_ptr<ChunkCache> chunkCache);
+
+    std::shared_ptr<ChunkCache> GetCache() const { return cache; }
+
+    void LoadCachedColumns(int centerX, int centerZ, int radius);
+
+    void StoreToCache() const;
+
     bool isPlayerCollides(double X, double Y, double Z) const;
 
     const std::vector<Vector>& GetSectionsList() const { return sectionsList; }
 
     const Section &GetSection(const Vector& sectionPos) const;
 
+    //Column is loaded if any its section is, air-only sections are never sent
+    bool IsColumnLoaded(int chunkX, int chunkZ) const;
+
     RaycastResult Raycast(const glm::vec3& position, const glm::vec3& direction) const;
 
     void UpdatePhysics(float delta);
@@ -85,6 +128,12 @@ public:
 
     void SetBlockId(const Vector& pos, BlockId block);
 
+    //Applies block edit at once and remembers it until server sends the block back
+    void PredictBlockId(const Vector& pos, BlockId block);
+
+    //Rolls back predicted edits not confirmed by server within timeout
+    void UpdatePendingEdits();
+
     void SetBlockLight(const Vector& pos, unsigned char light);
 
     void SetBlockSkyLight(const Vector& pos, unsigned char light);
@@ -1,6 +1,7 @@
 #include "Event.hpp"
 #include "Utility.hpp"
 #include "Game.hpp"
+#include "AsyncLog.hpp"
 
 #include <set>
 
@@ -27,8 +28,11 @@ void initLogger() {
     loggerConfiguration.set(el::Level::Fatal, el::ConfigurationType::Format, format);
     loggerConfiguration.set(el::Level::Warning, el::ConfigurationType::Format, format);
     el::Helpers::setThreadName("Render");
+    std::string logFile = el::Loggers::getLogger("default")->typedConfigurations()->filename(el::Level::Info);
+    loggerConfiguration.setGlobally(el::ConfigurationType::ToFile, "false");
     el::Loggers::reconfigureAllLoggers(loggerConfiguration);
     el::Loggers::addFlag(el::LoggingFlag::ColoredTerminalOutput);
+    AsyncLog::Init(logFile);
     LOG(INFO) << "Logger is configured";    
 }
 
@@ -41,10 +45,12 @@ int main(int argc, char** argv) {
             throw std::runtime_error(std::string("SDL initialization failed: ") + SDL_GetError());
     } catch (std::exception& e) {
         LOG(ERROR) << e.what();
+        AsyncLog::Shutdown();
         return -1;
     }
     
 	RunGame();
-	
+
+	AsyncLog::Shutdown();
 	return 0;
 }
\ No newline at end of file